@@ -0,0 +1,73 @@
+#include "analysis.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "tracker.h"
+
+typedef struct {
+    AnalysisResult* result;
+    int capacity;
+} BeatCollector;
+
+static void collect_beat(const TrackerEvent* event, void* userData) {
+    BeatCollector* collector = (BeatCollector*)userData;
+    AnalysisResult* result = collector->result;
+
+    if (event->type != TRACKER_EVENT_BEAT) return;
+
+    if (result->numBeats == collector->capacity) {
+        int capacity = collector->capacity ? collector->capacity * 2 : 256;
+        double* beats = (double*)realloc(result->beats, capacity * sizeof(double));
+        if (!beats) return;
+        result->beats = beats;
+        collector->capacity = capacity;
+    }
+    result->beats[result->numBeats++] = event->time;
+}
+
+int analyzeBuffer(const float* samples, size_t frameCount,
+                  const ParameterSet* parameters, AnalysisResult* result) {
+    return analyzeBufferSets(samples, frameCount, parameters, 1, result);
+}
+
+int analyzeBufferSets(const float* samples, size_t frameCount,
+                      const ParameterSet* parameterSets, int numSets, AnalysisResult* results) {
+    if (numSets < 1 || numSets > MAX_TRACKER_FOLLOWERS + 1) {
+        return -1;
+    }
+
+    // The first tracker leads and the others follow it over the same converted blocks
+    Tracker* trackers[MAX_TRACKER_FOLLOWERS + 1];
+    BeatCollector collectors[MAX_TRACKER_FOLLOWERS + 1];
+    int created;
+    for (created = 0; created < numSets; created++) {
+        memset(&results[created], 0, sizeof(AnalysisResult));
+        trackers[created] = createTracker(BTT_ONSET_AND_TEMPO_AND_BEAT_TRACKING,
+                                          parameterSets ? &parameterSets[created] : NULL);
+        if (!trackers[created]) break;
+
+        collectors[created].result = &results[created];
+        collectors[created].capacity = 0;
+        setTrackerEventCallback(trackers[created], collect_beat, &collectors[created]);
+        if (created > 0) addTrackerFollower(trackers[0], trackers[created]);
+    }
+
+    if (created == numSets) {
+        processTrackerAudio(trackers[0], samples, frameCount);
+        for (int i = 0; i < numSets; i++) {
+            results[i].tempo = trackers[i]->tempo;
+        }
+    }
+
+    for (int i = 0; i < created; i++) {
+        destroyTracker(trackers[i]);
+        if (created < numSets) freeAnalysisResult(&results[i]);
+    }
+    return created == numSets ? 0 : -1;
+}
+
+void freeAnalysisResult(AnalysisResult* result) {
+    free(result->beats);
+    result->beats = NULL;
+    result->numBeats = 0;
+}
@@ -0,0 +1,25 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <stddef.h>
+#include "parameters.h"
+
+#define ANALYSIS_SAMPLE_RATE 44100  // what btt_new_default() is configured for
+
+typedef struct {
+    double* beats;      // seconds
+    int numBeats;
+    double tempo;       // final tempo estimate in BPM
+} AnalysisResult;
+
+// Runs a fresh BTT in beat tracking mode over a mono buffer sampled at ANALYSIS_SAMPLE_RATE
+int analyzeBuffer(const float* samples, size_t frameCount,
+                  const ParameterSet* parameters, AnalysisResult* result);
+// Same for several parameter sets at once, one result per set. The sets share the conversion
+// of each block (see addTrackerFollower()); BTT itself still runs once per set. Up to
+// MAX_TRACKER_FOLLOWERS + 1 sets.
+int analyzeBufferSets(const float* samples, size_t frameCount,
+                      const ParameterSet* parameterSets, int numSets, AnalysisResult* results);
+void freeAnalysisResult(AnalysisResult* result);
+
+#endif // ANALYSIS_H
@@ -0,0 +1,54 @@
+#include "analysis_node.h"
+
+#define ANALYSIS_NODE_CHUNK_FRAMES 1024
+
+static void analysis_node_process(ma_node* pNode, const float** ppFramesIn, ma_uint32* pFrameCountIn,
+                                  float** ppFramesOut, ma_uint32* pFrameCountOut) {
+    AnalysisNode* node = (AnalysisNode*)pNode;
+    // For a passthrough node the input already is the output; nothing to copy
+    const float* frames = ppFramesIn[0];
+    ma_uint32 frameCount = *pFrameCountIn;
+    (void)ppFramesOut;
+    (void)pFrameCountOut;
+
+    if (node->waveform) {
+        // The waveform shows the first channel; gather it so the ring is written once per block
+        float firstChannel[ANALYSIS_NODE_CHUNK_FRAMES];
+        for (ma_uint32 pos = 0; pos < frameCount; pos += ANALYSIS_NODE_CHUNK_FRAMES) {
+            ma_uint32 count = (frameCount - pos < ANALYSIS_NODE_CHUNK_FRAMES) ? frameCount - pos : ANALYSIS_NODE_CHUNK_FRAMES;
+            for (ma_uint32 i = 0; i < count; i++) {
+                firstChannel[i] = frames[(pos + i) * node->channels];
+            }
+            writeToCircularBuffer(node->waveform, firstChannel, (int)count);
+        }
+    }
+
+    if (node->tracker) {
+        pushTrackerAudio(node->tracker, frames, frameCount, (int)node->channels);
+    }
+}
+
+static ma_node_vtable analysis_node_vtable = {
+    analysis_node_process,
+    NULL,
+    1,  // input buses
+    1,  // output buses
+    MA_NODE_FLAG_PASSTHROUGH
+};
+
+ma_result initAnalysisNode(ma_node_graph* graph, ma_uint32 channels, Tracker* tracker, CircularBuffer* waveform,
+                           AnalysisNode* node) {
+    node->tracker = tracker;
+    node->waveform = waveform;
+    node->channels = channels;
+
+    ma_node_config config = ma_node_config_init();
+    config.vtable = &analysis_node_vtable;
+    config.pInputChannels = &node->channels;
+    config.pOutputChannels = &node->channels;
+    return ma_node_init(graph, &config, NULL, &node->base);
+}
+
+void uninitAnalysisNode(AnalysisNode* node) {
+    ma_node_uninit(&node->base, NULL);
+}
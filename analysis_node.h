@@ -0,0 +1,25 @@
+#ifndef ANALYSIS_NODE_H
+#define ANALYSIS_NODE_H
+
+#include "circular_buffer.h"
+#include "tracker.h"
+
+#include "lib/miniaudio.h"
+
+// A miniaudio node that taps the audio flowing through a node graph for analysis. It is a
+// passthrough node, so miniaudio reads its input straight into the output buffer and the node
+// only looks at it: each block is handed to a started Tracker, and its first channel to the
+// waveform buffer when there is one. Anything in front of it (sources, mixers, effects) is
+// analyzed exactly as it is heard.
+typedef struct {
+    ma_node_base base;  // must be first
+    Tracker* tracker;           // may be NULL for a tap that only feeds the waveform
+    CircularBuffer* waveform;   // may be NULL
+    ma_uint32 channels;
+} AnalysisNode;
+
+ma_result initAnalysisNode(ma_node_graph* graph, ma_uint32 channels, Tracker* tracker, CircularBuffer* waveform,
+                           AnalysisNode* node);
+void uninitAnalysisNode(AnalysisNode* node);
+
+#endif // ANALYSIS_NODE_H
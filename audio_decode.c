@@ -0,0 +1,163 @@
+#include "audio_decode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lib/miniaudio.h"
+
+#define DECODE_CHUNK_FRAMES 65536
+
+static const char CACHE_MAGIC[8] = {'T', 'T', 'P', 'C', 'M', '0', '0', '1'};
+
+typedef struct {
+    char magic[8];
+    uint32_t sampleRate;
+    uint32_t reserved;
+    uint64_t frameCount;
+} CacheHeader;
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static int cache_path(const char* path, unsigned int sampleRate, const char* cacheDir, char* out, size_t outSize) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return -1;
+    }
+
+    int64_t size = (int64_t)st.st_size;
+    int64_t mtime = (int64_t)st.st_mtime;
+    uint64_t hash = 14695981039346656037ULL;
+    hash = fnv1a(hash, path, strlen(path));
+    hash = fnv1a(hash, &size, sizeof(size));
+    hash = fnv1a(hash, &mtime, sizeof(mtime));
+    hash = fnv1a(hash, &sampleRate, sizeof(sampleRate));
+
+    snprintf(out, outSize, "%s/%016llx.pcm", cacheDir, (unsigned long long)hash);
+    return 0;
+}
+
+static int read_cache(const char* cacheFile, unsigned int sampleRate, DecodedAudio* out) {
+    FILE* file = fopen(cacheFile, "rb");
+    if (!file) {
+        return -1;
+    }
+
+    CacheHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+        header.sampleRate != sampleRate) {
+        fclose(file);
+        return -1;
+    }
+
+    float* samples = (float*)malloc((header.frameCount ? header.frameCount : 1) * sizeof(float));
+    if (!samples || fread(samples, sizeof(float), header.frameCount, file) != header.frameCount) {
+        free(samples);
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    out->samples = samples;
+    out->frameCount = (size_t)header.frameCount;
+    out->sampleRate = sampleRate;
+    return 0;
+}
+
+static void write_cache(const char* cacheFile, const DecodedAudio* audio) {
+    // Write to a private temporary and rename, so concurrent readers never see a partial file
+    char tmpFile[4096 + 32];
+    snprintf(tmpFile, sizeof(tmpFile), "%s.%ld.tmp", cacheFile, (long)getpid());
+
+    FILE* file = fopen(tmpFile, "wb");
+    if (!file) {
+        return;
+    }
+
+    CacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.sampleRate = audio->sampleRate;
+    header.reserved = 0;
+    header.frameCount = audio->frameCount;
+
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(audio->samples, sizeof(float), audio->frameCount, file) == audio->frameCount;
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok || rename(tmpFile, cacheFile) != 0) {
+        remove(tmpFile);
+    }
+}
+
+static int decode_file(const char* path, unsigned int sampleRate, DecodedAudio* out) {
+    // Asking the decoder for a single channel makes miniaudio do the downmix
+    ma_decoder_config config = ma_decoder_config_init(ma_format_f32, 1, sampleRate);
+    ma_decoder decoder;
+    if (ma_decoder_init_file(path, &config, &decoder) != MA_SUCCESS) {
+        return -1;
+    }
+
+    size_t capacity = DECODE_CHUNK_FRAMES;
+    size_t count = 0;
+    float* samples = (float*)malloc(capacity * sizeof(float));
+
+    for (;;) {
+        if (count + DECODE_CHUNK_FRAMES > capacity) {
+            capacity *= 2;
+            float* grown = (float*)realloc(samples, capacity * sizeof(float));
+            if (!grown) {
+                free(samples);
+                ma_decoder_uninit(&decoder);
+                return -1;
+            }
+            samples = grown;
+        }
+
+        ma_uint64 framesRead = 0;
+        ma_result result = ma_decoder_read_pcm_frames(&decoder, samples + count, DECODE_CHUNK_FRAMES, &framesRead);
+        count += (size_t)framesRead;
+        if (result != MA_SUCCESS || framesRead < DECODE_CHUNK_FRAMES) {
+            break;
+        }
+    }
+    ma_decoder_uninit(&decoder);
+
+    out->samples = samples;
+    out->frameCount = count;
+    out->sampleRate = sampleRate;
+    return 0;
+}
+
+int decodeAudioFile(const char* path, unsigned int sampleRate, const char* cacheDir, DecodedAudio* out) {
+    char cacheFile[4096];
+    int useCache = cacheDir != NULL && cache_path(path, sampleRate, cacheDir, cacheFile, sizeof(cacheFile)) == 0;
+
+    if (useCache && read_cache(cacheFile, sampleRate, out) == 0) {
+        return 0;
+    }
+
+    if (decode_file(path, sampleRate, out) != 0) {
+        return -1;
+    }
+
+    if (useCache) {
+        write_cache(cacheFile, out);
+    }
+    return 0;
+}
+
+void freeDecodedAudio(DecodedAudio* audio) {
+    free(audio->samples);
+    audio->samples = NULL;
+    audio->frameCount = 0;
+}
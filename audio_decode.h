@@ -0,0 +1,17 @@
+#ifndef AUDIO_DECODE_H
+#define AUDIO_DECODE_H
+
+#include <stddef.h>
+
+typedef struct {
+    float* samples;     // mono
+    size_t frameCount;
+    unsigned int sampleRate;
+} DecodedAudio;
+
+// Decodes a whole file to mono float at sampleRate. When cacheDir is not NULL the decoded
+// samples are looked up in / stored to that directory, keyed on path, size and mtime.
+int decodeAudioFile(const char* path, unsigned int sampleRate, const char* cacheDir, DecodedAudio* out);
+void freeDecodedAudio(DecodedAudio* audio);
+
+#endif // AUDIO_DECODE_H
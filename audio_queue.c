@@ -50,7 +50,9 @@ AudioFrame dequeueAudioFrame(AudioQueue* queue) {
         pthread_cond_wait(&queue->cond, &queue->mutex);
     }
 
+    // The caller now owns frame.data
     AudioFrame frame = queue->frames[queue->head];
+    queue->frames[queue->head].data = NULL;
     queue->head = (queue->head + 1) % queue->capacity;
 
     pthread_cond_signal(&queue->cond);
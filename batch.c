@@ -0,0 +1,148 @@
+#include "batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+static const char* AUDIO_EXTENSIONS[] = {".wav", ".flac", ".mp3"};
+
+static int has_audio_extension(const char* path) {
+    const char* extension = strrchr(path, '.');
+    if (!extension) return 0;
+    for (int i = 0; i < (int)(sizeof(AUDIO_EXTENSIONS) / sizeof(AUDIO_EXTENSIONS[0])); i++) {
+        if (strcasecmp(extension, AUDIO_EXTENSIONS[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static void append_path(FileList* list, const char* path) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 64;
+        list->paths = (char**)realloc(list->paths, list->capacity * sizeof(char*));
+    }
+    list->paths[list->count++] = strdup(path);
+}
+
+int addAudioFiles(FileList* list, const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "Could not open: %s\n", path);
+        return -1;
+    }
+
+    if (!S_ISDIR(st.st_mode)) {
+        append_path(list, path);
+        return 0;
+    }
+
+    DIR* dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "Could not open directory: %s\n", path);
+        return -1;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+
+        char child[4096];
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        if (stat(child, &st) != 0) continue;
+
+        if (S_ISDIR(st.st_mode)) {
+            addAudioFiles(list, child);
+        } else if (has_audio_extension(child)) {
+            append_path(list, child);
+        }
+    }
+    closedir(dir);
+    return 0;
+}
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+void sortFileList(FileList* list) {
+    qsort(list->paths, list->count, sizeof(char*), compare_paths);
+}
+
+void freeFileList(FileList* list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+    list->paths = NULL;
+    list->count = list->capacity = 0;
+}
+
+int parseShard(const char* spec, int* shardIndex, int* shardCount) {
+    if (sscanf(spec, "%d/%d", shardIndex, shardCount) != 2 ||
+        *shardCount < 1 || *shardIndex < 0 || *shardIndex >= *shardCount) {
+        return -1;
+    }
+    return 0;
+}
+
+void selectShard(FileList* list, int shardIndex, int shardCount) {
+    int kept = 0;
+    for (int i = 0; i < list->count; i++) {
+        if (i % shardCount == shardIndex) {
+            list->paths[kept++] = list->paths[i];
+        } else {
+            free(list->paths[i]);
+        }
+    }
+    list->count = kept;
+}
+
+typedef struct {
+    const FileList* list;
+    BatchJob job;
+    void* userData;
+    int next;
+    pthread_mutex_t mutex;
+} BatchState;
+
+static void* batch_worker(void* arg) {
+    BatchState* state = (BatchState*)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&state->mutex);
+        int index = state->next++;
+        pthread_mutex_unlock(&state->mutex);
+
+        if (index >= state->list->count) break;
+        state->job(index, state->list->paths[index], state->userData);
+    }
+
+    return NULL;
+}
+
+void runBatch(const FileList* list, int numThreads, BatchJob job, void* userData) {
+    BatchState state = {list, job, userData, 0, PTHREAD_MUTEX_INITIALIZER};
+
+    if (numThreads < 1) numThreads = 1;
+    if (numThreads > list->count) numThreads = list->count;
+
+    pthread_t* threads = (pthread_t*)malloc(numThreads * sizeof(pthread_t));
+    int started = 0;
+    for (int i = 0; i < numThreads; i++) {
+        if (pthread_create(&threads[i], NULL, batch_worker, &state) != 0) break;
+        started++;
+    }
+
+    // Fall back to the calling thread if no worker could be started
+    if (started == 0) {
+        batch_worker(&state);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    pthread_mutex_destroy(&state.mutex);
+}
@@ -0,0 +1,27 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+typedef struct {
+    char** paths;
+    int count;
+    int capacity;
+} FileList;
+
+// Adds a file, or every .wav/.flac/.mp3 below a directory. Call sortFileList() afterwards
+// so every run sees the corpus in the same order.
+int addAudioFiles(FileList* list, const char* path);
+void sortFileList(FileList* list);
+void freeFileList(FileList* list);
+
+// Parses "i/n" with 0 <= i < n
+int parseShard(const char* spec, int* shardIndex, int* shardCount);
+// Keeps every n-th file of the sorted list starting at i, so shards are disjoint and
+// together cover the corpus no matter which machine runs them
+void selectShard(FileList* list, int shardIndex, int shardCount);
+
+typedef void (*BatchJob)(int index, const char* path, void* userData);
+
+// Runs job once per file on numThreads worker threads
+void runBatch(const FileList* list, int numThreads, BatchJob job, void* userData);
+
+#endif // BATCH_H
@@ -0,0 +1,265 @@
+#include "beat_metrics.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char* BEAT_SCORE_NAMES[NUM_BEAT_SCORES] = {
+    "f_measure", "cemgil", "p_score", "cmlt", "amlt", "acc1", "acc2"
+};
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+double medianInterval(const double* beats, int numBeats) {
+    if (numBeats < 2) {
+        return 0;
+    }
+
+    int count = numBeats - 1;
+    double* intervals = (double*)malloc(count * sizeof(double));
+    for (int i = 0; i < count; i++) {
+        intervals[i] = beats[i + 1] - beats[i];
+    }
+    qsort(intervals, count, sizeof(double), compare_doubles);
+
+    double median = (count % 2) ? intervals[count / 2]
+                                : 0.5 * (intervals[count / 2 - 1] + intervals[count / 2]);
+    free(intervals);
+    return median;
+}
+
+static int trim_beats(const double* beats, int numBeats, double** out) {
+    int start = 0;
+    while (start < numBeats && beats[start] < BEAT_TRIM_SECONDS) {
+        start++;
+    }
+    *out = (double*)malloc((numBeats - start + 1) * sizeof(double));
+    memcpy(*out, beats + start, (numBeats - start) * sizeof(double));
+    return numBeats - start;
+}
+
+static double f_measure(const double* ref, int numRef, const double* est, int numEst) {
+    if (numRef == 0 || numEst == 0) {
+        return 0;
+    }
+
+    // Both lists are sorted, so greedy matching within the window is a maximum matching
+    int matches = 0;
+    int i = 0, j = 0;
+    while (i < numRef && j < numEst) {
+        double difference = est[j] - ref[i];
+        if (fabs(difference) <= BEAT_F_MEASURE_WINDOW) {
+            matches++;
+            i++;
+            j++;
+        } else if (difference < 0) {
+            j++;
+        } else {
+            i++;
+        }
+    }
+
+    if (matches == 0) {
+        return 0;
+    }
+    double precision = (double)matches / numEst;
+    double recall = (double)matches / numRef;
+    return 2 * precision * recall / (precision + recall);
+}
+
+static double cemgil(const double* ref, int numRef, const double* est, int numEst) {
+    if (numRef == 0 || numEst == 0) {
+        return 0;
+    }
+
+    double sum = 0;
+    int j = 0;
+    for (int i = 0; i < numRef; i++) {
+        // Advance to the estimate nearest to this reference beat
+        while (j + 1 < numEst && fabs(est[j + 1] - ref[i]) <= fabs(est[j] - ref[i])) {
+            j++;
+        }
+        double error = est[j] - ref[i];
+        sum += exp(-(error * error) / (2 * BEAT_CEMGIL_SIGMA * BEAT_CEMGIL_SIGMA));
+    }
+    return sum / (0.5 * (numRef + numEst));
+}
+
+static double p_score(const double* ref, int numRef, const double* est, int numEst) {
+    if (numRef < 2 || numEst == 0) {
+        return 0;
+    }
+
+    // Beats are quantized to 10 ms impulse trains and cross-correlated within
+    // +/- a fraction of the median reference inter-beat interval
+    const double samplingRate = 100;
+    double offset = (ref[0] < est[0]) ? ref[0] : est[0];
+    long window = (long)(BEAT_P_SCORE_THRESHOLD * samplingRate * medianInterval(ref, numRef));
+
+    long* refTrain = (long*)malloc(numRef * sizeof(long));
+    long* estTrain = (long*)malloc(numEst * sizeof(long));
+    for (int i = 0; i < numRef; i++) refTrain[i] = (long)((ref[i] - offset) * samplingRate);
+    for (int j = 0; j < numEst; j++) estTrain[j] = (long)((est[j] - offset) * samplingRate);
+
+    // Several beats can fall into the same bin; the impulse train only holds one
+    int numRefUnique = 0, numEstUnique = 0;
+    for (int i = 0; i < numRef; i++) {
+        if (numRefUnique == 0 || refTrain[numRefUnique - 1] != refTrain[i]) refTrain[numRefUnique++] = refTrain[i];
+    }
+    for (int j = 0; j < numEst; j++) {
+        if (numEstUnique == 0 || estTrain[numEstUnique - 1] != estTrain[j]) estTrain[numEstUnique++] = estTrain[j];
+    }
+
+    long correlation = 0;
+    int lo = 0;
+    for (int i = 0; i < numRefUnique; i++) {
+        while (lo < numEstUnique && estTrain[lo] < refTrain[i] - window) {
+            lo++;
+        }
+        for (int j = lo; j < numEstUnique && estTrain[j] <= refTrain[i] + window; j++) {
+            correlation++;
+        }
+    }
+    free(refTrain);
+    free(estTrain);
+
+    return (double)correlation / ((numRef > numEst) ? numRef : numEst);
+}
+
+static double continuity_total(const double* ref, int numRef, const double* est, int numEst) {
+    if (numRef < 2 || numEst < 2) {
+        return 0;
+    }
+
+    int numAnnotations = (numRef > numEst) ? numRef : numEst;
+    char* used = (char*)calloc(numRef, 1);
+    int successes = 0;
+
+    int nearest = 0;
+    for (int m = 0; m < numEst; m++) {
+        while (nearest + 1 < numRef && fabs(est[m] - ref[nearest + 1]) < fabs(est[m] - ref[nearest])) {
+            nearest++;
+        }
+        while (nearest > 0 && fabs(est[m] - ref[nearest - 1]) <= fabs(est[m] - ref[nearest])) {
+            nearest--;
+        }
+        if (used[nearest]) {
+            continue;
+        }
+
+        double referenceInterval, estimatedInterval;
+        if (m == 0 || nearest == 0) {
+            // At the start there is no previous beat, so look forward instead
+            referenceInterval = (nearest + 1 < numRef) ? ref[nearest + 1] - ref[nearest]
+                                                       : ref[nearest] - ref[nearest - 1];
+            estimatedInterval = (m + 1 < numEst) ? est[m + 1] - est[m] : est[m] - est[m - 1];
+        } else {
+            referenceInterval = ref[nearest] - ref[nearest - 1];
+            estimatedInterval = est[m] - est[m - 1];
+        }
+        if (referenceInterval == 0) {
+            continue;
+        }
+
+        double phase = fabs((est[m] - ref[nearest]) / referenceInterval);
+        double period = fabs(1 - estimatedInterval / referenceInterval);
+        if (phase < BEAT_CONTINUITY_PHASE_THRESHOLD && period < BEAT_CONTINUITY_PERIOD_THRESHOLD) {
+            used[nearest] = 1;
+            successes++;
+        }
+    }
+    free(used);
+
+    return (double)successes / numAnnotations;
+}
+
+static void continuity(const double* ref, int numRef, const double* est, int numEst,
+                       double* cmlt, double* amlt) {
+    *cmlt = continuity_total(ref, numRef, est, numEst);
+    *amlt = *cmlt;
+    if (numRef < 2) {
+        return;
+    }
+
+    // Allowed metrical levels: off-beat, double tempo and both half tempo phases
+    int numDouble = 2 * numRef - 1;
+    double* doubled = (double*)malloc(numDouble * sizeof(double));
+    double* variation = (double*)malloc(numDouble * sizeof(double));
+    for (int i = 0; i < numRef; i++) {
+        doubled[2 * i] = ref[i];
+        if (i + 1 < numRef) doubled[2 * i + 1] = 0.5 * (ref[i] + ref[i + 1]);
+    }
+
+    double total;
+    int count = 0;
+    for (int i = 1; i < numDouble; i += 2) variation[count++] = doubled[i];
+    total = continuity_total(variation, count, est, numEst);
+    if (total > *amlt) *amlt = total;
+
+    total = continuity_total(doubled, numDouble, est, numEst);
+    if (total > *amlt) *amlt = total;
+
+    for (int phase = 0; phase < 2; phase++) {
+        count = 0;
+        for (int i = phase; i < numRef; i += 2) variation[count++] = ref[i];
+        total = continuity_total(variation, count, est, numEst);
+        if (total > *amlt) *amlt = total;
+    }
+
+    free(doubled);
+    free(variation);
+}
+
+static int tempo_matches(double referenceTempo, double estimatedTempo, double factor) {
+    double target = referenceTempo * factor;
+    return fabs(estimatedTempo - target) <= TEMPO_TOLERANCE * target;
+}
+
+void computeBeatScores(const double* reference, int numReference,
+                       const double* estimated, int numEstimated,
+                       double referenceTempo, double estimatedTempo,
+                       BeatScores* scores) {
+    memset(scores, 0, sizeof(*scores));
+
+    double *ref, *est;
+    int numRef = trim_beats(reference, numReference, &ref);
+    int numEst = trim_beats(estimated, numEstimated, &est);
+
+    scores->fMeasure = f_measure(ref, numRef, est, numEst);
+    scores->cemgil = cemgil(ref, numRef, est, numEst);
+    scores->pScore = p_score(ref, numRef, est, numEst);
+    continuity(ref, numRef, est, numEst, &scores->cmlt, &scores->amlt);
+
+    free(ref);
+    free(est);
+
+    if (referenceTempo <= 0) {
+        double interval = medianInterval(reference, numReference);
+        referenceTempo = (interval > 0) ? 60.0 / interval : 0;
+    }
+    if (referenceTempo > 0 && estimatedTempo > 0) {
+        static const double factors[] = {1.0, 2.0, 3.0, 1.0 / 2.0, 1.0 / 3.0};
+        scores->acc1 = tempo_matches(referenceTempo, estimatedTempo, 1.0);
+        for (int i = 0; i < (int)(sizeof(factors) / sizeof(factors[0])); i++) {
+            if (tempo_matches(referenceTempo, estimatedTempo, factors[i])) {
+                scores->acc2 = 1;
+            }
+        }
+    }
+}
+
+double beatScoreAt(const BeatScores* scores, int index) {
+    switch (index) {
+        case 0: return scores->fMeasure;
+        case 1: return scores->cemgil;
+        case 2: return scores->pScore;
+        case 3: return scores->cmlt;
+        case 4: return scores->amlt;
+        case 5: return scores->acc1;
+        case 6: return scores->acc2;
+        default: return 0;
+    }
+}
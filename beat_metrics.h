@@ -0,0 +1,35 @@
+#ifndef BEAT_METRICS_H
+#define BEAT_METRICS_H
+
+// Conventions follow the MIREX beat tracking task (and mir_eval)
+#define BEAT_TRIM_SECONDS 5.0
+#define BEAT_F_MEASURE_WINDOW 0.07
+#define BEAT_CEMGIL_SIGMA 0.04
+#define BEAT_P_SCORE_THRESHOLD 0.2
+#define BEAT_CONTINUITY_PHASE_THRESHOLD 0.175
+#define BEAT_CONTINUITY_PERIOD_THRESHOLD 0.175
+#define TEMPO_TOLERANCE 0.04
+
+typedef struct {
+    double fMeasure;
+    double cemgil;
+    double pScore;
+    double cmlt;
+    double amlt;
+    double acc1;
+    double acc2;
+} BeatScores;
+
+#define NUM_BEAT_SCORES 7
+extern const char* BEAT_SCORE_NAMES[NUM_BEAT_SCORES];
+
+// Beat times are in seconds and must be sorted. Beats before BEAT_TRIM_SECONDS are ignored.
+// Tempos are in BPM; a reference tempo <= 0 is derived from the reference beats.
+void computeBeatScores(const double* reference, int numReference,
+                       const double* estimated, int numEstimated,
+                       double referenceTempo, double estimatedTempo,
+                       BeatScores* scores);
+double beatScoreAt(const BeatScores* scores, int index);
+double medianInterval(const double* beats, int numBeats);
+
+#endif // BEAT_METRICS_H
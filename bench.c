@@ -0,0 +1,920 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define INVALID_SOCKET_HANDLE INVALID_SOCKET
+#define close_socket closesocket
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET_HANDLE (-1)
+#define close_socket close
+#endif
+
+#include "lib/Beat-and-Tempo-Tracking/BTT.h"
+// BTT's internal stages, from lib/Beat-and-Tempo-Tracking/src
+#include "DFT.h"
+#include "Filter.h"
+#include "STFT.h"
+#include "Statistics.h"
+#include "analysis.h"
+#include "audio_queue.h"
+#include "beat_metrics.h"
+#include "circular_buffer.h"
+#include "engine.h"
+#include "event_stream.h"
+#include "osc_output.h"
+#include "test_signal.h"
+#include "timing.h"
+#include "waveform.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <stdint.h>
+
+#include "shm_ring.h"
+#endif
+
+#define BENCH_SAMPLE_RATE 44100
+#define BENCH_SIGNAL_SECONDS 30
+#define WAVEFORM_WIDTH 800
+#define WAVEFORM_SAMPLES (44100 * 4)
+#define ENGINE_STREAMS 16
+#define ENGINE_BLOCK 1024
+#define OSC_CHECK_BEATS 8
+#define OSC_CHECK_LATENCY 0.1
+// Seconds from the NTP epoch (1900) to the Unix epoch
+#define NTP_UNIX_OFFSET 2208988800.0
+
+typedef void (*BenchFunction)(void* state, long long iterations);
+
+typedef struct {
+    const char* filter;
+    double minSeconds;
+} BenchOptions;
+
+// Doubles the iteration count until one timed run takes at least minSeconds, then prints
+// one JSON object per line. framesPerIteration is the audio consumed by one iteration and
+// gives the real-time factor; pass 0 for benchmarks that do not process audio.
+static void run_benchmark(const BenchOptions* options, const char* name, int size,
+                          BenchFunction function, void* state, long long framesPerIteration) {
+    if (options->filter && !strstr(name, options->filter)) {
+        return;
+    }
+
+    long long iterations = 1;
+    double elapsed;
+    for (;;) {
+        double start = getMonotonicTime();
+        function(state, iterations);
+        elapsed = getMonotonicTime() - start;
+        if (elapsed >= options->minSeconds || iterations >= (1LL << 40)) break;
+        iterations *= 2;
+    }
+
+    printf("{\"name\":\"%s\",\"size\":%d,\"iterations\":%lld,\"seconds\":%.6f,\"ns_per_op\":%.1f",
+           name, size, iterations, elapsed, elapsed * 1e9 / (double)iterations);
+    if (framesPerIteration > 0) {
+        double audioSeconds = (double)(framesPerIteration * iterations) / BENCH_SAMPLE_RATE;
+        printf(",\"x_realtime\":%.2f", audioSeconds / elapsed);
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+
+/**
+ * BTT
+ */
+typedef struct {
+    BTT* btt;
+    dft_sample_t* signal;
+    int frameCount;
+    int blockSize;
+    int position;
+} BTTBench;
+
+static void bench_btt_process(void* arg, long long iterations) {
+    BTTBench* bench = (BTTBench*)arg;
+    for (long long n = 0; n < iterations; n++) {
+        if (bench->position + bench->blockSize > bench->frameCount) bench->position = 0;
+        btt_process(bench->btt, bench->signal + bench->position, bench->blockSize);
+        bench->position += bench->blockSize;
+    }
+}
+
+static void run_btt_benchmarks(const BenchOptions* options, float* signal, int frameCount) {
+    // Each tracking mode adds a stage on top of the previous one, so the difference between
+    // two rows is the cost of that stage:
+    //   onset:      STFT/DFT, spectral flux, OSS filter and the adaptive threshold statistics
+    //   tempo:      + autocorrelation and tempo histogram
+    //   beat:       + cumulative beat strength signal and beat prediction
+    static const struct { const char* name; btt_tracking_mode_t mode; } stages[] = {
+        {"btt_stage_onset", BTT_ONSET_TRACKING},
+        {"btt_stage_tempo", BTT_ONSET_AND_TEMPO_TRACKING},
+        {"btt_stage_beat", BTT_ONSET_AND_TEMPO_AND_BEAT_TRACKING},
+    };
+    static const int blockSizes[] = {64, 256, 1024, 4096};
+
+    // Converted once up front so the timed loop matches whatever sample type BTT is built with
+    dft_sample_t* input = (dft_sample_t*)malloc(frameCount * sizeof(dft_sample_t));
+    for (int i = 0; i < frameCount; i++) input[i] = signal[i];
+
+    BTTBench bench = {NULL, input, frameCount, 1024, 0};
+
+    for (int s = 0; s < (int)(sizeof(stages) / sizeof(stages[0])); s++) {
+        bench.btt = btt_new_default();
+        btt_set_tracking_mode(bench.btt, stages[s].mode);
+        bench.blockSize = 1024;
+        bench.position = 0;
+        run_benchmark(options, stages[s].name, bench.blockSize, bench_btt_process, &bench, bench.blockSize);
+        btt_destroy(bench.btt);
+    }
+
+    for (int b = 0; b < (int)(sizeof(blockSizes) / sizeof(blockSizes[0])); b++) {
+        bench.btt = btt_new_default();
+        btt_set_tracking_mode(bench.btt, BTT_ONSET_AND_TEMPO_AND_BEAT_TRACKING);
+        bench.blockSize = blockSizes[b];
+        bench.position = 0;
+        run_benchmark(options, "btt_process", bench.blockSize, bench_btt_process, &bench, bench.blockSize);
+        btt_destroy(bench.btt);
+    }
+
+    free(input);
+}
+
+/**
+ * BTT stages, called directly with the sizes BTT uses
+ */
+typedef struct {
+    dft_sample_t* input;    // the signal
+    int inputCount;
+    int position;
+    dft_sample_t* real;
+    dft_sample_t* imag;
+    dft_sample_t* window;
+    int size;
+    STFT* stft;
+    Filter* filter;
+    OnlineAverage* average;
+    double exponent;
+} StageBench;
+
+// Takes the next size samples of the signal, wrapping around
+static dft_sample_t* next_input(StageBench* bench) {
+    if (bench->position + bench->size > bench->inputCount) bench->position = 0;
+    dft_sample_t* input = bench->input + bench->position;
+    bench->position += bench->size;
+    return input;
+}
+
+// The transforms work in place, so each iteration starts from a fresh copy of the input
+static void bench_dft_real_forward(void* arg, long long iterations) {
+    StageBench* bench = (StageBench*)arg;
+    for (long long n = 0; n < iterations; n++) {
+        memcpy(bench->real, next_input(bench), bench->size * sizeof(dft_sample_t));
+        dft_apply_window(bench->real, bench->window, bench->size);
+        dft_real_forward(bench->real, bench->imag, bench->size);
+    }
+}
+
+static void bench_dft_rect_to_polar(void* arg, long long iterations) {
+    StageBench* bench = (StageBench*)arg;
+    for (long long n = 0; n < iterations; n++) {
+        memcpy(bench->real, next_input(bench), bench->size * sizeof(dft_sample_t));
+        memcpy(bench->imag, next_input(bench), bench->size * sizeof(dft_sample_t));
+        dft_rect_to_polar(bench->real, bench->imag, bench->size);
+    }
+}
+
+static void on_stft_frame(void* self, dft_sample_t* real, dft_sample_t* imag, int N) {
+    (void)self;
+    (void)real;
+    (void)imag;
+    (void)N;
+}
+
+static void bench_stft_process(void* arg, long long iterations) {
+    StageBench* bench = (StageBench*)arg;
+    for (long long n = 0; n < iterations; n++) {
+        memcpy(bench->real, next_input(bench), bench->size * sizeof(dft_sample_t));
+        stft_process(bench->stft, bench->real, bench->size, on_stft_frame, NULL);
+    }
+}
+
+static void bench_oss_filter(void* arg, long long iterations) {
+    StageBench* bench = (StageBench*)arg;
+    for (long long n = 0; n < iterations; n++) {
+        memcpy(bench->real, next_input(bench), bench->size * sizeof(dft_sample_t));
+        filter_process_data(bench->filter, bench->real, bench->size);
+    }
+}
+
+static void bench_online_average(void* arg, long long iterations) {
+    StageBench* bench = (StageBench*)arg;
+    for (long long n = 0; n < iterations; n++) {
+        dft_sample_t* input = next_input(bench);
+        for (int i = 0; i < bench->size; i++) {
+            online_average_update(bench->average, input[i]);
+        }
+    }
+}
+
+static void bench_autocorrelation(void* arg, long long iterations) {
+    StageBench* bench = (StageBench*)arg;
+    for (long long n = 0; n < iterations; n++) {
+        memcpy(bench->real, next_input(bench), bench->size * sizeof(dft_sample_t));
+        dft_real_generalized_autocorrelation(bench->real, bench->imag, bench->size, bench->exponent);
+    }
+}
+
+static void run_stage_benchmarks(const BenchOptions* options, float* signal, int frameCount) {
+    int stftLength = BTT_SUGGESTED_SPECTRAL_FLUX_STFT_LEN;
+    int hop = stftLength / BTT_SUGGESTED_SPECTRAL_FLUX_STFT_OVERLAP;
+    int ossLength = BTT_SUGGESTED_OSS_LENGTH;
+    int maxSize = stftLength > ossLength ? stftLength : ossLength;
+
+    // The filter cutoff and autocorrelation exponent are BTT's defaults
+    BTT* defaults = btt_new_default();
+    StageBench bench;
+    memset(&bench, 0, sizeof(bench));
+    bench.input = (dft_sample_t*)malloc(frameCount * sizeof(dft_sample_t));
+    for (int i = 0; i < frameCount; i++) bench.input[i] = signal[i];
+    bench.inputCount = frameCount;
+    bench.real = (dft_sample_t*)calloc(maxSize, sizeof(dft_sample_t));
+    bench.imag = (dft_sample_t*)calloc(maxSize, sizeof(dft_sample_t));
+    bench.window = (dft_sample_t*)calloc(stftLength, sizeof(dft_sample_t));
+    dft_init_hann_window(bench.window, stftLength);
+    bench.stft = stft_new(stftLength, BTT_SUGGESTED_SPECTRAL_FLUX_STFT_OVERLAP, 0);
+    bench.filter = filter_new(FILTER_LOW_PASS, btt_get_oss_filter_cutoff(defaults), BTT_SUGGESTED_OSS_FILTER_ORDER);
+    bench.average = online_average_new();
+    bench.exponent = btt_get_autocorrelation_exponent(defaults);
+
+    // One STFT frame: window and real FFT, then magnitudes for the spectral flux
+    bench.size = stftLength;
+    run_benchmark(options, "stage_dft_real_forward", bench.size, bench_dft_real_forward, &bench, 0);
+    bench.size = stftLength / 2;
+    run_benchmark(options, "stage_dft_rect_to_polar", bench.size, bench_dft_rect_to_polar, &bench, 0);
+    // A hop of audio through the STFT's buffering, windowing and transform
+    bench.size = hop;
+    run_benchmark(options, "stage_stft_process", bench.size, bench_stft_process, &bench, bench.size);
+    // BTT filters and thresholds one onset strength value per hop; a block of them here
+    bench.size = ossLength;
+    run_benchmark(options, "stage_oss_filter", bench.size, bench_oss_filter, &bench, 0);
+    run_benchmark(options, "stage_statistics_online_average", bench.size, bench_online_average, &bench, 0);
+    // The tempo estimate autocorrelates the whole onset strength signal
+    run_benchmark(options, "stage_autocorrelation", bench.size, bench_autocorrelation, &bench, 0);
+
+    online_average_destroy(bench.average);
+    filter_destroy(bench.filter);
+    stft_destroy(bench.stft);
+    btt_destroy(defaults);
+    free(bench.window);
+    free(bench.imag);
+    free(bench.real);
+    free(bench.input);
+}
+
+/**
+ * AudioQueue
+ */
+typedef struct {
+    AudioQueue* queue;
+    float* block;
+    int blockSize;
+} QueueBench;
+
+static void bench_audio_queue(void* arg, long long iterations) {
+    QueueBench* bench = (QueueBench*)arg;
+    for (long long n = 0; n < iterations; n++) {
+        enqueueAudioFrame(bench->queue, bench->block, bench->blockSize);
+        AudioFrame frame = dequeueAudioFrame(bench->queue);
+        free(frame.data);
+    }
+}
+
+/**
+ * CircularBuffer
+ */
+typedef struct {
+    CircularBuffer* buffer;
+    float* data;
+    int count;
+} CircularBufferBench;
+
+static void bench_circular_buffer_write_sample(void* arg, long long iterations) {
+    CircularBufferBench* bench = (CircularBufferBench*)arg;
+    // What data_callback does: one call per frame
+    for (long long n = 0; n < iterations; n++) {
+        for (int i = 0; i < bench->count; i++) {
+            writeToCircularBuffer(bench->buffer, &bench->data[i], 1);
+        }
+    }
+}
+
+static void bench_circular_buffer_write_block(void* arg, long long iterations) {
+    CircularBufferBench* bench = (CircularBufferBench*)arg;
+    for (long long n = 0; n < iterations; n++) {
+        writeToCircularBuffer(bench->buffer, bench->data, bench->count);
+    }
+}
+
+static void bench_circular_buffer_read(void* arg, long long iterations) {
+    CircularBufferBench* bench = (CircularBufferBench*)arg;
+    for (long long n = 0; n < iterations; n++) {
+        readFromCircularBuffer(bench->buffer, bench->data, bench->count);
+    }
+}
+
+/**
+ * Waveform reduction
+ */
+typedef struct {
+    float* data;
+    int count;
+    float minValues[WAVEFORM_WIDTH];
+    float maxValues[WAVEFORM_WIDTH];
+} WaveformBench;
+
+static void bench_waveform_reduce(void* arg, long long iterations) {
+    WaveformBench* bench = (WaveformBench*)arg;
+    for (long long n = 0; n < iterations; n++) {
+        reduceWaveform(bench->data, bench->count, WAVEFORM_WIDTH, bench->minValues, bench->maxValues);
+    }
+}
+
+static void run_buffer_benchmarks(const BenchOptions* options, float* signal) {
+    QueueBench queueBench = {createAudioQueue(1024), signal, 512};
+    run_benchmark(options, "audio_queue_roundtrip", queueBench.blockSize, bench_audio_queue, &queueBench, queueBench.blockSize);
+    destroyAudioQueue(queueBench.queue);
+
+    CircularBufferBench cbBench = {createCircularBuffer(WAVEFORM_SAMPLES), signal, 512};
+    run_benchmark(options, "circular_buffer_write_sample", cbBench.count, bench_circular_buffer_write_sample, &cbBench, cbBench.count);
+    run_benchmark(options, "circular_buffer_write_block", cbBench.count, bench_circular_buffer_write_block, &cbBench, cbBench.count);
+    destroyCircularBuffer(cbBench.buffer);
+
+    float* window = (float*)malloc(WAVEFORM_SAMPLES * sizeof(float));
+    CircularBufferBench readBench = {createCircularBuffer(WAVEFORM_SAMPLES), window, WAVEFORM_SAMPLES};
+    writeToCircularBuffer(readBench.buffer, signal, WAVEFORM_SAMPLES);
+    run_benchmark(options, "circular_buffer_read_window", readBench.count, bench_circular_buffer_read, &readBench, 0);
+    destroyCircularBuffer(readBench.buffer);
+    free(window);
+
+    WaveformBench* waveformBench = (WaveformBench*)malloc(sizeof(WaveformBench));
+    waveformBench->data = signal;
+    waveformBench->count = WAVEFORM_SAMPLES;
+    run_benchmark(options, "waveform_reduce", WAVEFORM_WIDTH, bench_waveform_reduce, waveformBench, 0);
+    free(waveformBench);
+}
+
+/**
+ * Engine
+ */
+typedef struct {
+    EngineStream* streams[ENGINE_STREAMS];
+    float* signal;
+    int frameCount;
+    int position;
+} EngineBench;
+
+static void bench_engine_streams(void* arg, long long iterations) {
+    EngineBench* bench = (EngineBench*)arg;
+    for (long long n = 0; n < iterations; n++) {
+        if (bench->position + ENGINE_BLOCK > bench->frameCount) bench->position = 0;
+        for (int s = 0; s < ENGINE_STREAMS; s++) {
+            // Every stream gets the whole block, so the run measures analysis and not drops
+            const float* block = bench->signal + bench->position;
+            size_t written = 0;
+            while (written < ENGINE_BLOCK) {
+                written += writeEngineStream(bench->streams[s], block + written, ENGINE_BLOCK - written);
+            }
+        }
+        bench->position += ENGINE_BLOCK;
+    }
+    for (int s = 0; s < ENGINE_STREAMS; s++) {
+        drainEngineStream(bench->streams[s]);
+    }
+}
+
+static void run_engine_benchmarks(const BenchOptions* options, float* signal, int frameCount) {
+    if (options->filter && !strstr("engine_streams", options->filter)) {
+        return;
+    }
+
+    Engine* engine = createEngine(NULL);
+    EngineBench bench = {{NULL}, signal, frameCount, 0};
+    for (int s = 0; s < ENGINE_STREAMS; s++) {
+        bench.streams[s] = addEngineStream(engine, NULL, NULL, NULL);
+    }
+
+    run_benchmark(options, "engine_streams", ENGINE_STREAMS, bench_engine_streams, &bench, (long long)ENGINE_BLOCK * ENGINE_STREAMS);
+
+    double meanLatency = 0, maxLatency = 0;
+    for (int s = 0; s < ENGINE_STREAMS; s++) {
+        EngineStreamStats stats;
+        getEngineStreamStats(bench.streams[s], &stats);
+        meanLatency += stats.meanLatency / ENGINE_STREAMS;
+        if (stats.maxLatency > maxLatency) maxLatency = stats.maxLatency;
+        removeEngineStream(engine, bench.streams[s]);
+    }
+    printf("{\"name\":\"engine_streams_latency\",\"size\":%d,\"mean_ms\":%.3f,\"max_ms\":%.3f}\n",
+           ENGINE_STREAMS, meanLatency * 1e3, maxLatency * 1e3);
+    fflush(stdout);
+    destroyEngine(engine);
+}
+
+/**
+ * Tempo lock check
+ */
+typedef struct {
+    const char* name;
+    TestSignalPattern pattern;
+    double startBpm;
+    double endBpm;
+    double swing;
+    double snrDb;
+} CheckCase;
+
+static const CheckCase CHECK_CASES[] = {
+    {"click_90", TEST_SIGNAL_CLICK_TRACK, 90, 90, 0, TEST_SIGNAL_NO_NOISE},
+    {"click_120", TEST_SIGNAL_CLICK_TRACK, 120, 120, 0, TEST_SIGNAL_NO_NOISE},
+    {"drums_100", TEST_SIGNAL_DRUM_PATTERN, 100, 100, 0, TEST_SIGNAL_NO_NOISE},
+    {"drums_128_swing", TEST_SIGNAL_DRUM_PATTERN, 128, 128, 0.33, TEST_SIGNAL_NO_NOISE},
+    {"drums_120_snr6", TEST_SIGNAL_DRUM_PATTERN, 120, 120, 0, 6},
+    {"drums_ramp_110_130", TEST_SIGNAL_DRUM_PATTERN, 110, 130, 0, TEST_SIGNAL_NO_NOISE},
+};
+
+static TestSignalConfig check_config(const CheckCase* check) {
+    TestSignalConfig config = testSignalConfigInit(check->pattern, check->startBpm, BENCH_SIGNAL_SECONDS);
+    config.endBpm = check->endBpm;
+    config.swing = check->swing;
+    config.snrDb = check->snrDb;
+    return config;
+}
+
+// Runs BTT over each synthetic signal and fails unless the final tempo is within
+// TEMPO_TOLERANCE of the tempo the signal ends on
+static int run_checks(const char* renderDir) {
+    int failures = 0;
+
+    for (int c = 0; c < (int)(sizeof(CHECK_CASES) / sizeof(CHECK_CASES[0])); c++) {
+        const CheckCase* check = &CHECK_CASES[c];
+        TestSignalConfig config = check_config(check);
+        TestSignal signal;
+        AnalysisResult analysis;
+        BeatScores scores;
+
+        if (generateTestSignal(&config, &signal) != 0 ||
+            analyzeBuffer(signal.samples, signal.frameCount, NULL, &analysis) != 0) {
+            printf("FAIL %s: could not generate or analyze signal\n", check->name);
+            failures++;
+            continue;
+        }
+
+        if (renderDir) {
+            char basePath[4096];
+            snprintf(basePath, sizeof(basePath), "%s/%s", renderDir, check->name);
+            if (writeTestSignal(&signal, basePath) != 0) {
+                printf("Could not write %s\n", basePath);
+            }
+        }
+
+        computeBeatScores(signal.beats, signal.numBeats, analysis.beats, analysis.numBeats,
+                          signal.bpm, analysis.tempo, &scores);
+        int passed = scores.acc1 > 0;
+        if (!passed) failures++;
+
+        printf("%s %s: expected %.1f BPM, got %.1f BPM, f_measure %.3f\n",
+               passed ? "PASS" : "FAIL", check->name, signal.bpm, analysis.tempo, scores.fMeasure);
+
+        freeAnalysisResult(&analysis);
+        freeTestSignal(&signal);
+    }
+
+    return failures ? 1 : 0;
+}
+
+/**
+ * OSC output check: a synthetic run sent to a listener on the loopback interface
+ */
+typedef struct {
+    const char* address;
+    const char* typeTags;   // without the leading comma
+    const unsigned char* args;
+} OscMessage;
+
+static unsigned int read_uint32(const unsigned char* in) {
+    return (unsigned int)in[0] << 24 | (unsigned int)in[1] << 16 | (unsigned int)in[2] << 8 | in[3];
+}
+
+static float read_float(const unsigned char* in) {
+    unsigned int bits = read_uint32(in);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Length of the padded OSC string at offset, or 0 if it is not terminated within the packet
+static int osc_string_size(const unsigned char* data, int size, int offset) {
+    for (int i = offset; i < size; i++) {
+        if (data[i] == '\0') return ((i - offset + 1) + 3) & ~3;
+    }
+    return 0;
+}
+
+// Splits a packet into address, type tags and arguments; false if it is malformed or its size
+// does not match the type tags
+static bool parse_osc_message(const unsigned char* data, int size, OscMessage* message) {
+    int addressSize = osc_string_size(data, size, 0);
+    if (addressSize == 0 || data[0] != '/') return false;
+    int tagsSize = osc_string_size(data, size, addressSize);
+    if (tagsSize == 0 || data[addressSize] != ',') return false;
+
+    message->address = (const char*)data;
+    message->typeTags = (const char*)data + addressSize + 1;
+    message->args = data + addressSize + tagsSize;
+
+    int argsSize = 0;
+    for (const char* tag = message->typeTags; *tag; tag++) {
+        switch (*tag) {
+            case 'f':
+            case 'i': argsSize += 4; break;
+            case 't': argsSize += 8; break;
+            default: return false;
+        }
+    }
+    return addressSize + tagsSize + argsSize == size;
+}
+
+static double read_time_tag(const unsigned char* in) {
+    return (double)read_uint32(in) + read_uint32(in + 4) / 4294967296.0 - NTP_UNIX_OFFSET;
+}
+
+// Waits up to a second for the next packet; returns its size, or -1
+static int receive_packet(socket_t listener, unsigned char* data, int capacity) {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(listener, &readable);
+    struct timeval timeout = {1, 0};
+    if (select((int)listener + 1, &readable, NULL, NULL, &timeout) <= 0) {
+        return -1;
+    }
+    return (int)recv(listener, (char*)data, capacity, 0);
+}
+
+static socket_t open_listener(unsigned short* port) {
+    socket_t listener = socket(AF_INET, SOCK_DGRAM, 0);
+    if (listener == INVALID_SOCKET_HANDLE) {
+        return INVALID_SOCKET_HANDLE;
+    }
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t length = sizeof(address);
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        getsockname(listener, (struct sockaddr*)&address, &length) != 0) {
+        close_socket(listener);
+        return INVALID_SOCKET_HANDLE;
+    }
+    *port = ntohs(address.sin_port);
+    return listener;
+}
+
+// Sends a tempo change followed by an onset and a beat every half second through an OscOutput
+// and checks every packet the listener receives: addresses, type tags, values, the running
+// beat count and the beat time tags
+static int run_osc_check(void) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+    unsigned short port;
+    socket_t listener = open_listener(&port);
+    if (listener == INVALID_SOCKET_HANDLE) {
+        printf("FAIL osc: could not listen on 127.0.0.1\n");
+        return 1;
+    }
+    char address[32];
+    snprintf(address, sizeof(address), "127.0.0.1:%u", port);
+    OscOutput* output = createOscOutput(address, BENCH_SAMPLE_RATE);
+    if (!output || startOscOutput(output) != 0) {
+        printf("FAIL osc: could not start the output to %s\n", address);
+        if (output) destroyOscOutput(output);
+        close_socket(listener);
+        return 1;
+    }
+    setOscOutputLatency(output, OSC_CHECK_LATENCY);
+
+    // Beats arrive every half second from now on; the sender stamps each with the time it is
+    // heard, after the analysis delay is taken off and the device latency added
+    double period = 60.0 / 120.0;
+    double start = getMonotonicTime();
+    double wallOffset = getWallClockTime() - start;
+    double shift = (double)EVENT_STREAM_ANALYSIS_DELAY_FRAMES / BENCH_SAMPLE_RATE;
+
+    TrackerEvent event;
+    memset(&event, 0, sizeof(event));
+    event.type = TRACKER_EVENT_TEMPO;
+    event.tempo = 120;
+    event.arrivalTime = start;
+    oscOutputCallback(&event, output);
+    for (int beat = 0; beat < OSC_CHECK_BEATS; beat++) {
+        event.sampleIndex = (unsigned long long)((beat + 1) * period * BENCH_SAMPLE_RATE);
+        event.time = (double)event.sampleIndex / BENCH_SAMPLE_RATE;
+        event.arrivalTime = start + (beat + 1) * period;
+        event.level = 0.5f + 0.05f * (float)beat;
+        event.type = TRACKER_EVENT_ONSET;
+        oscOutputCallback(&event, output);
+        event.type = TRACKER_EVENT_BEAT;
+        oscOutputCallback(&event, output);
+    }
+
+    const char* failure = NULL;
+    unsigned char data[256];
+    OscMessage message;
+    for (int i = 0; i < 1 + 2 * OSC_CHECK_BEATS && !failure; i++) {
+        int size = receive_packet(listener, data, (int)sizeof(data));
+        if (size <= 0) {
+            failure = "packet missing";
+        } else if (!parse_osc_message(data, size, &message)) {
+            failure = "malformed packet";
+        } else if (i == 0) {
+            if (strcmp(message.address, "/tempo") != 0 || strcmp(message.typeTags, "f") != 0) {
+                failure = "expected /tempo f first";
+            } else if (read_float(message.args) != 120.0f) {
+                failure = "wrong tempo";
+            }
+        } else if (i % 2 == 1) {
+            int beat = i / 2;
+            if (strcmp(message.address, "/onset") != 0 || strcmp(message.typeTags, "f") != 0) {
+                failure = "expected /onset f";
+            } else if (read_float(message.args) != 0.5f + 0.05f * (float)beat) {
+                failure = "wrong onset strength";
+            }
+        } else {
+            int beat = i / 2 - 1;
+            double expected = wallOffset + start + (beat + 1) * period - shift + OSC_CHECK_LATENCY;
+            if (strcmp(message.address, "/beat") != 0 || strcmp(message.typeTags, "it") != 0) {
+                failure = "expected /beat i t";
+            } else if ((int)read_uint32(message.args) != beat) {
+                failure = "wrong beat count";
+            } else if (fabs(read_time_tag(message.args + 4) - expected) > 0.01) {
+                failure = "beat time tag off by more than 10 ms";
+            }
+        }
+    }
+
+    destroyOscOutput(output);
+    close_socket(listener);
+    if (failure) {
+        printf("FAIL osc: %s\n", failure);
+        return 1;
+    }
+    printf("PASS osc: /tempo, %d /onset and %d /beat messages decoded from %s\n", OSC_CHECK_BEATS,
+           OSC_CHECK_BEATS, address);
+    return 0;
+}
+
+#ifdef __linux__
+/**
+ * Shared memory ring check: a producer thread streams a synthetic signal through a small ring
+ */
+#define SHM_CHECK_CAPACITY 4096
+#define SHM_CHECK_CHUNK 1000
+
+typedef struct {
+    int fd;
+    const TestSignal* signal;
+    ShmSampleFormat format;
+    unsigned long long waits;
+} ShmCheckProducer;
+
+static int16_t to_s16(float sample) {
+    if (sample > 1.0f) sample = 1.0f;
+    if (sample < -1.0f) sample = -1.0f;
+    return (int16_t)lrintf(sample * 32767.0f);
+}
+
+// Writes the signal as an external producer would, through its own mapping of the ring
+static void* shm_check_producer(void* arg) {
+    ShmCheckProducer* producer = (ShmCheckProducer*)arg;
+    ShmRing* ring = openShmRingFd(producer->fd);
+    if (!ring) {
+        return NULL;
+    }
+
+    const TestSignal* signal = producer->signal;
+    int16_t converted[SHM_CHECK_CHUNK];
+    for (size_t pos = 0; pos < signal->frameCount; pos += SHM_CHECK_CHUNK) {
+        size_t count = signal->frameCount - pos < SHM_CHECK_CHUNK ? signal->frameCount - pos : SHM_CHECK_CHUNK;
+        const unsigned char* frames = (const unsigned char*)(signal->samples + pos);
+        if (producer->format == SHM_FORMAT_S16) {
+            for (size_t i = 0; i < count; i++) {
+                converted[i] = to_s16(signal->samples[pos + i]);
+            }
+            frames = (const unsigned char*)converted;
+        }
+
+        size_t done = 0;
+        while (done < count) {
+            if (getShmRingWritable(ring) == 0) {
+                producer->waits++;
+                waitShmRingWritable(ring, 1, -1);
+            }
+            done += writeShmRing(ring, frames + done * ring->frameSize, count - done);
+        }
+    }
+    finishShmRing(ring);
+    closeShmRing(ring);
+    return NULL;
+}
+
+// Streams the signal through a ring and compares every frame the reader sees with what was
+// written. Returns NULL on success.
+static const char* check_shm_stream(const TestSignal* signal, ShmSampleFormat format, unsigned long long* waits) {
+    ShmRing* ring = createShmRing(NULL, SHM_CHECK_CAPACITY, signal->sampleRate, format);
+    if (!ring) {
+        return "could not create a ring";
+    }
+    ShmCheckProducer producer = {dup(ring->fd), signal, format, 0};
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, shm_check_producer, &producer) != 0) {
+        closeShmRing(ring);
+        return "could not start the producer";
+    }
+
+    const char* failure = NULL;
+    size_t received = 0;
+    while (!isShmRingFinished(ring)) {
+        if (!waitShmRingReadable(ring, 1000)) {
+            failure = "the producer stalled";
+            break;
+        }
+        size_t count;
+        const void* frames = peekShmRing(ring, &count);
+        // Keep consuming after a mismatch so the producer can finish
+        for (size_t i = 0; i < count && !failure; i++) {
+            if (received + i >= signal->frameCount) {
+                failure = "more frames than were written";
+            } else if (format == SHM_FORMAT_S16) {
+                if (((const int16_t*)frames)[i] != to_s16(signal->samples[received + i])) failure = "frames differ";
+            } else if (((const float*)frames)[i] != signal->samples[received + i]) {
+                failure = "frames differ";
+            }
+        }
+        consumeShmRing(ring, count);
+        received += count;
+    }
+    pthread_join(thread, NULL);
+
+    if (!failure && ring->broken) failure = "the ring broke";
+    if (!failure && received != signal->frameCount) failure = "frames missing";
+    closeShmRing(ring);
+    *waits = producer.waits;
+    return failure;
+}
+
+// What a broken producer could leave in the header: a capacity that no longer matches the
+// mapping and a write index further ahead than the ring holds
+static const char* check_shm_corruption(void) {
+    ShmRing* ring = createShmRing(NULL, SHM_CHECK_CAPACITY, BENCH_SAMPLE_RATE, SHM_FORMAT_F32);
+    if (!ring) {
+        return "could not create a ring";
+    }
+
+    const char* failure = NULL;
+    ring->header->capacity = (uint64_t)1 << 40;
+    ShmRing* reopened = openShmRingFd(dup(ring->fd));
+    if (reopened) {
+        closeShmRing(reopened);
+        failure = "opened a ring whose capacity exceeds the mapping";
+    }
+
+    __atomic_store_n(&ring->header->writeIndex, (uint64_t)4 * SHM_CHECK_CAPACITY, __ATOMIC_RELEASE);
+    size_t count;
+    peekShmRing(ring, &count);
+    if (!failure && (count != 0 || !isShmRingFinished(ring))) {
+        failure = "a write index past the capacity was not detected";
+    }
+    closeShmRing(ring);
+    return failure;
+}
+
+static int run_shm_check(void) {
+    TestSignalConfig config = testSignalConfigInit(TEST_SIGNAL_DRUM_PATTERN, 120, 10);
+    TestSignal signal;
+    if (generateTestSignal(&config, &signal) != 0) {
+        printf("FAIL shm: could not generate the signal\n");
+        return 1;
+    }
+
+    int failures = 0;
+    static const struct { const char* name; ShmSampleFormat format; } formats[] = {
+        {"f32", SHM_FORMAT_F32},
+        {"s16", SHM_FORMAT_S16},
+    };
+    for (int f = 0; f < 2; f++) {
+        unsigned long long waits = 0;
+        const char* failure = check_shm_stream(&signal, formats[f].format, &waits);
+        if (failure) {
+            printf("FAIL shm %s: %s\n", formats[f].name, failure);
+            failures++;
+        } else {
+            printf("PASS shm %s: %zu frames through a %d frame ring, the producer waited %llu times\n",
+                   formats[f].name, signal.frameCount, SHM_CHECK_CAPACITY, waits);
+        }
+    }
+
+    const char* failure = check_shm_corruption();
+    if (failure) {
+        printf("FAIL shm corrupted header: %s\n", failure);
+        failures++;
+    } else {
+        printf("PASS shm corrupted header: rejected on open and detected by the reader\n");
+    }
+
+    freeTestSignal(&signal);
+    return failures ? 1 : 0;
+}
+#endif
+
+static void print_usage(const char* program) {
+    printf("Usage: %s [--filter name] [--min-time seconds]\n", program);
+    printf("       %s --check [--render dir]\n", program);
+    printf("       %s --check-osc\n", program);
+    printf("       %s --check-shm\n", program);
+    printf("Prints one JSON object per benchmark and line. --check verifies that BTT locks onto the\n");
+    printf("tempo of the synthetic signals, --render also writes them as WAV files with annotations.\n");
+    printf("--check-osc sends a synthetic run over OSC to a local UDP listener and decodes it.\n");
+    printf("--check-shm streams a synthetic signal through a shared memory ring from a producer thread\n");
+    printf("and checks that it arrives intact and that a corrupted ring header is caught (Linux only).\n");
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options = {NULL, 0.5};
+    const char* renderDir = NULL;
+    int check = 0;
+    int checkOsc = 0;
+    int checkShm = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            options.minSeconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--check") == 0) {
+            check = 1;
+        } else if (strcmp(argv[i], "--check-osc") == 0) {
+            checkOsc = 1;
+        } else if (strcmp(argv[i], "--check-shm") == 0) {
+            checkShm = 1;
+        } else if (strcmp(argv[i], "--render") == 0 && i + 1 < argc) {
+            renderDir = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+
+    if (checkOsc) {
+        return run_osc_check();
+    }
+    if (checkShm) {
+#ifdef __linux__
+        return run_shm_check();
+#else
+        printf("--check-shm is only available on Linux\n");
+        return 1;
+#endif
+    }
+    if (check || renderDir) {
+        return run_checks(renderDir);
+    }
+
+    // The benchmarks run on the same deterministic drum pattern as the checks
+    TestSignalConfig config = testSignalConfigInit(TEST_SIGNAL_DRUM_PATTERN, 120, BENCH_SIGNAL_SECONDS);
+    TestSignal signal;
+    if (generateTestSignal(&config, &signal) != 0) {
+        printf("Could not generate the benchmark signal\n");
+        return 1;
+    }
+
+    run_btt_benchmarks(&options, signal.samples, (int)signal.frameCount);
+    run_stage_benchmarks(&options, signal.samples, (int)signal.frameCount);
+    run_buffer_benchmarks(&options, signal.samples);
+    run_engine_benchmarks(&options, signal.samples, (int)signal.frameCount);
+
+    freeTestSignal(&signal);
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "capture.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static void capture_callback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount) {
+    Capture* capture = (Capture*)pDevice->pUserData;
+    const float* input = (const float*)pInput;
+
+    if (capture->waveform) {
+        writeToCircularBuffer(capture->waveform, input, (int)frameCount);
+    }
+    pushTrackerAudio(capture->tracker, input, frameCount, 1);
+
+    (void)pOutput;
+}
+
+Capture* createCapture(Tracker* tracker, CircularBuffer* waveform, unsigned periodFrames) {
+    Capture* capture = (Capture*)calloc(1, sizeof(Capture));
+    capture->tracker = tracker;
+    capture->waveform = waveform;
+
+    ma_device_config deviceConfig = ma_device_config_init(ma_device_type_capture);
+    deviceConfig.capture.format = ma_format_f32;
+    deviceConfig.capture.channels = 1;
+    deviceConfig.sampleRate = (ma_uint32)tracker->sampleRate;
+    deviceConfig.periodSizeInFrames = periodFrames ? periodFrames : CAPTURE_DEFAULT_PERIOD_FRAMES;
+    deviceConfig.performanceProfile = ma_performance_profile_low_latency;
+    deviceConfig.dataCallback = capture_callback;
+    deviceConfig.pUserData = capture;
+
+    if (ma_device_init(NULL, &deviceConfig, &capture->device) != MA_SUCCESS) {
+        printf("Failed to open capture device.\n");
+        free(capture);
+        return NULL;
+    }
+
+    capture->periodFrames = capture->device.capture.internalPeriodSizeInFrames;
+    capture->periods = capture->device.capture.internalPeriods;
+    return capture;
+}
+
+void destroyCapture(Capture* capture) {
+    ma_device_uninit(&capture->device);
+    free(capture);
+}
+
+int startCapture(Capture* capture) {
+    if (ma_device_start(&capture->device) != MA_SUCCESS) {
+        printf("Failed to start capture device.\n");
+        return -1;
+    }
+    return 0;
+}
+
+void stopCapture(Capture* capture) {
+    if (ma_device_is_started(&capture->device)) {
+        ma_device_stop(&capture->device);
+    }
+}
+
+double getDeviceLatency(ma_device* device) {
+    if (device->type == ma_device_type_capture) {
+        return -(double)device->capture.internalPeriodSizeInFrames * device->capture.internalPeriods
+               / device->capture.internalSampleRate;
+    }
+    return (double)device->playback.internalPeriodSizeInFrames * device->playback.internalPeriods
+           / device->playback.internalSampleRate;
+}
@@ -0,0 +1,33 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "circular_buffer.h"
+#include "tracker.h"
+
+#include "lib/miniaudio.h"
+
+#define CAPTURE_DEFAULT_PERIOD_FRAMES 128
+
+// Feeds a capture device (microphone or line input) straight into a started Tracker. There
+// is no playback; the waveform copy is only made when a buffer is given, so the headless
+// path does nothing in the audio callback but hand the block to the tracker.
+typedef struct {
+    ma_device device;
+    Tracker* tracker;
+    CircularBuffer* waveform;   // may be NULL
+    unsigned periodFrames;      // what the backend actually gave us
+    unsigned periods;
+} Capture;
+
+// periodFrames of 0 uses CAPTURE_DEFAULT_PERIOD_FRAMES. The device runs at the tracker's
+// sample rate in mono, so miniaudio does the downmix and any resampling.
+Capture* createCapture(Tracker* tracker, CircularBuffer* waveform, unsigned periodFrames);
+void destroyCapture(Capture* capture);
+int startCapture(Capture* capture);
+void stopCapture(Capture* capture);
+
+// The device's buffer in seconds from its period size and count, positive for playback and
+// negative for capture, as setEventStreamLatency() expects
+double getDeviceLatency(ma_device* device);
+
+#endif // CAPTURE_H
@@ -18,14 +18,28 @@ void destroyCircularBuffer(CircularBuffer* cb) {
     free(cb);
 }
 
-void writeToCircularBuffer(CircularBuffer* cb, float* data, int count) {
+void writeToCircularBuffer(CircularBuffer* cb, const float* data, int count) {
+    if (count <= 0) return;
+
     pthread_mutex_lock(&cb->mutex);
-    for (int i = 0; i < count; i++) {
-        cb->buffer[cb->head] = data[i];
-        cb->head = (cb->head + 1) % cb->size;
-        if (cb->head == cb->tail) {
-            cb->tail = (cb->tail + 1) % cb->size;
-        }
+    int available = (cb->head - cb->tail + cb->size) % cb->size;
+
+    // Anything older than the last size samples would be overwritten anyway
+    int skipped = (count > cb->size) ? count - cb->size : 0;
+    int head = (cb->head + skipped) % cb->size;
+    data += skipped;
+    int toWrite = count - skipped;
+
+    // Copy as at most two contiguous runs instead of wrapping per sample
+    int firstRun = cb->size - head;
+    if (firstRun > toWrite) firstRun = toWrite;
+    memcpy(cb->buffer + head, data, firstRun * sizeof(float));
+    memcpy(cb->buffer, data + firstRun, (toWrite - firstRun) * sizeof(float));
+
+    cb->head = (head + toWrite) % cb->size;
+    if (available + count > cb->size - 1) {
+        // Full: the oldest sample sits right after the newest one
+        cb->tail = (cb->head + 1) % cb->size;
     }
     pthread_mutex_unlock(&cb->mutex);
 }
@@ -36,10 +50,10 @@ int readFromCircularBuffer(CircularBuffer* cb, float* data, int count) {
     int toRead = (count < available) ? count : available;
 
     int readIndex = (cb->head - toRead + cb->size) % cb->size;
-    for (int i = 0; i < toRead; i++) {
-        data[i] = cb->buffer[readIndex];
-        readIndex = (readIndex + 1) % cb->size;
-    }
+    int firstRun = cb->size - readIndex;
+    if (firstRun > toRead) firstRun = toRead;
+    memcpy(data, cb->buffer + readIndex, firstRun * sizeof(float));
+    memcpy(data + firstRun, cb->buffer, (toRead - firstRun) * sizeof(float));
     pthread_mutex_unlock(&cb->mutex);
 
     return toRead;
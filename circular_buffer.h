@@ -13,7 +13,7 @@ typedef struct {
 
 CircularBuffer* createCircularBuffer(int size);
 void destroyCircularBuffer(CircularBuffer* cb);
-void writeToCircularBuffer(CircularBuffer* cb, float* data, int count);
+void writeToCircularBuffer(CircularBuffer* cb, const float* data, int count);
 int readFromCircularBuffer(CircularBuffer* cb, float* data, int count);
 int getAvailableData(CircularBuffer* cb);
 void clearCircularBuffer(CircularBuffer* cb);
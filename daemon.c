@@ -0,0 +1,578 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "analysis.h"
+#include "daemon_protocol.h"
+#include "engine.h"
+#include "event_format.h"
+#include "parameters.h"
+#include "spsc_ring.h"
+
+#include "lib/miniaudio.h"
+
+#define DEFAULT_MAX_SESSIONS 16
+#define DEFAULT_POOL_SIZE 4
+#define INPUT_BUFFER_BYTES 65536
+#define CONVERT_FRAMES 8192
+#define SESSION_EVENT_CAPACITY 4096
+// Past this much unsent output a session stops taking input and leaves its events in the ring
+#define MAX_OUTPUT_BYTES (1 << 20)
+#define MAX_EPOLL_EVENTS 64
+// While a session waits for room in its engine ring, or for its last hop to be analyzed
+#define RETRY_MILLISECONDS 2
+
+typedef struct Session Session;
+
+// An engine stream with its event ring; sessions take one from the pool while they are open
+typedef struct {
+    EngineStream* stream;
+    SpscRing* events;       // DaemonEvent, written by the engine worker analyzing the stream
+    Session* session;
+    int wakeFd;
+    unsigned long long droppedEvents;   // events lost to a full ring, atomic
+} Slot;
+
+struct Session {
+    int fd;
+    Slot* slot;
+    DaemonHeader header;
+    size_t headerFill;
+    bool started;           // header received and converter ready
+    ma_data_converter converter;
+    size_t bytesPerFrame;
+
+    unsigned char input[INPUT_BUFFER_BYTES];
+    size_t inputFill;
+    float converted[CONVERT_FRAMES];
+    size_t convertedCount;
+    size_t convertedPos;
+    bool throttled;         // not reading until the engine has room
+    bool finished;          // client closed its side
+    ma_uint64 flushFrames;  // silence still to push through the resampler after the last input
+
+    char* output;
+    size_t outputFill;
+    size_t outputCapacity;
+    uint32_t interest;      // epoll events currently registered for fd
+    unsigned long long reportedDrops;
+};
+
+typedef struct {
+    Engine* engine;
+    ParameterSet parameters;
+    int epollFd;
+    int listenFd;
+    int wakeFd;
+    Session** sessions;
+    int maxSessions;
+    int numSessions;
+    Slot** pool;
+    int poolSize;
+    int poolCount;
+} Daemon;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void on_signal(int signal) {
+    (void)signal;
+    stopRequested = 1;
+}
+
+/**
+ * Slots
+ */
+static void on_stream_event(const TrackerEvent* event, void* userData) {
+    Slot* slot = (Slot*)userData;
+
+    DaemonEvent daemonEvent;
+    daemonEvent.type = (uint32_t)event->type;
+    daemonEvent.reserved = 0;
+    daemonEvent.sampleIndex = event->sampleIndex;   // converted to the client's rate on send
+    daemonEvent.time = event->time;
+    daemonEvent.tempo = event->tempo;
+    if (writeSpscRing(slot->events, &daemonEvent, 1) == 0) {
+        __atomic_add_fetch(&slot->droppedEvents, 1, __ATOMIC_RELAXED);
+    }
+
+    uint64_t one = 1;
+    ssize_t written = write(slot->wakeFd, &one, sizeof(one));
+    (void)written;
+}
+
+static Slot* create_slot(Daemon* daemon) {
+    Slot* slot = (Slot*)calloc(1, sizeof(Slot));
+    slot->events = createSpscRing(SESSION_EVENT_CAPACITY, sizeof(DaemonEvent));
+    slot->wakeFd = daemon->wakeFd;
+    slot->stream = addEngineStream(daemon->engine, &daemon->parameters, on_stream_event, slot);
+    if (!slot->stream) {
+        destroySpscRing(slot->events);
+        free(slot);
+        return NULL;
+    }
+    return slot;
+}
+
+static void destroy_slot(Daemon* daemon, Slot* slot) {
+    removeEngineStream(daemon->engine, slot->stream);
+    destroySpscRing(slot->events);
+    free(slot);
+}
+
+// BTT keeps state from the previous stream, so used slots are replaced rather than reused
+static void refill_pool(Daemon* daemon) {
+    while (daemon->poolCount < daemon->poolSize) {
+        Slot* slot = create_slot(daemon);
+        if (!slot) break;
+        daemon->pool[daemon->poolCount++] = slot;
+    }
+}
+
+static Slot* take_slot(Daemon* daemon) {
+    if (daemon->poolCount > 0) {
+        return daemon->pool[--daemon->poolCount];
+    }
+    return create_slot(daemon);
+}
+
+/**
+ * Sessions
+ */
+static void append_output(Session* session, const void* data, size_t size) {
+    if (session->outputFill + size > session->outputCapacity) {
+        size_t capacity = session->outputCapacity ? session->outputCapacity : 4096;
+        while (capacity < session->outputFill + size) capacity *= 2;
+        session->output = (char*)realloc(session->output, capacity);
+        session->outputCapacity = capacity;
+    }
+    memcpy(session->output + session->outputFill, data, size);
+    session->outputFill += size;
+}
+
+static void send_error(int fd, const char* message) {
+    char line[256];
+    int length = snprintf(line, sizeof(line), "{\"error\":\"%s\"}\n", message);
+    ssize_t written = write(fd, line, (size_t)length);
+    (void)written;
+}
+
+// The socket is level triggered, so a throttled session must drop EPOLLIN or epoll_wait would
+// keep returning for the data it is not reading
+static void update_interest(Daemon* daemon, Session* session) {
+    uint32_t interest = 0;
+    if (!session->throttled && !session->finished) interest |= EPOLLIN;
+    if (session->outputFill > 0) interest |= EPOLLOUT;
+    if (interest == session->interest) {
+        return;
+    }
+
+    struct epoll_event event;
+    event.events = interest;
+    event.data.ptr = session;
+    epoll_ctl(daemon->epollFd, EPOLL_CTL_MOD, session->fd, &event);
+    session->interest = interest;
+}
+
+static void close_session(Daemon* daemon, Session* session) {
+    epoll_ctl(daemon->epollFd, EPOLL_CTL_DEL, session->fd, NULL);
+    close(session->fd);
+    if (session->started) {
+        ma_data_converter_uninit(&session->converter, NULL);
+    }
+    if (session->slot) {
+        destroy_slot(daemon, session->slot);
+    }
+    free(session->output);
+
+    for (int i = 0; i < daemon->numSessions; i++) {
+        if (daemon->sessions[i] == session) {
+            daemon->sessions[i] = daemon->sessions[--daemon->numSessions];
+            break;
+        }
+    }
+    free(session);
+    if (!stopRequested) {
+        refill_pool(daemon);
+    }
+}
+
+static void accept_session(Daemon* daemon) {
+    int fd = accept(daemon->listenFd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    if (daemon->numSessions >= daemon->maxSessions) {
+        send_error(fd, "too many sessions");
+        close(fd);
+        return;
+    }
+
+    Slot* slot = take_slot(daemon);
+    if (!slot) {
+        send_error(fd, "could not create a tracker");
+        close(fd);
+        return;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    Session* session = (Session*)calloc(1, sizeof(Session));
+    session->fd = fd;
+    session->slot = slot;
+    slot->session = session;
+    daemon->sessions[daemon->numSessions++] = session;
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    session->interest = EPOLLIN;
+    event.data.ptr = session;
+    epoll_ctl(daemon->epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+static const char* start_session(Session* session) {
+    DaemonHeader* header = &session->header;
+    if (header->magic != DAEMON_MAGIC) return "bad magic";
+    if (header->channels < 1 || header->channels > 32) return "bad channel count";
+    if (header->sampleRate < 1000 || header->sampleRate > 384000) return "bad sample rate";
+    if (header->format != DAEMON_FORMAT_F32 && header->format != DAEMON_FORMAT_S16) return "bad sample format";
+    if (header->eventFormat != DAEMON_EVENTS_BINARY && header->eventFormat != DAEMON_EVENTS_JSON) return "bad event format";
+
+    // One converter does the sample format, the downmix and the resampling to BTT's rate
+    ma_format format = header->format == DAEMON_FORMAT_S16 ? ma_format_s16 : ma_format_f32;
+    ma_data_converter_config config = ma_data_converter_config_init(format, ma_format_f32, header->channels, 1,
+                                                                    header->sampleRate, ANALYSIS_SAMPLE_RATE);
+    if (ma_data_converter_init(&config, NULL, &session->converter) != MA_SUCCESS) {
+        return "could not create a converter";
+    }
+    session->bytesPerFrame = ma_get_bytes_per_frame(format, header->channels);
+    session->started = true;
+    return NULL;
+}
+
+// Hands converted audio to the engine; false when its ring is full
+static bool feed_engine(Session* session) {
+    while (session->convertedPos < session->convertedCount) {
+        size_t written = writeEngineStream(session->slot->stream, session->converted + session->convertedPos,
+                                           session->convertedCount - session->convertedPos);
+        if (written == 0) return false;
+        session->convertedPos += written;
+    }
+    return true;
+}
+
+// Converts whole frames from the input buffer until it is empty, the engine is full or the
+// client has fallen behind reading its events
+static void process_input(Session* session) {
+    for (;;) {
+        if (session->outputFill >= MAX_OUTPUT_BYTES || !feed_engine(session)) {
+            session->throttled = true;
+            return;
+        }
+
+        // Once the client has finished, the resampler's last frames are pushed out with silence
+        // (a NULL input reads as zeros)
+        const void* input = session->input;
+        ma_uint64 frameIn = session->inputFill / session->bytesPerFrame;
+        if (frameIn == 0) {
+            if (!session->finished || session->flushFrames == 0) break;
+            input = NULL;
+            frameIn = session->flushFrames;
+        }
+        ma_uint64 frameOut = CONVERT_FRAMES;
+        ma_data_converter_process_pcm_frames(&session->converter, input, &frameIn, session->converted, &frameOut);
+        if (frameIn == 0 && frameOut == 0) {
+            session->flushFrames = 0;
+            break;
+        }
+
+        if (input) {
+            size_t consumed = (size_t)frameIn * session->bytesPerFrame;
+            memmove(session->input, session->input + consumed, session->inputFill - consumed);
+            session->inputFill -= consumed;
+        } else {
+            session->flushFrames -= frameIn;
+        }
+        session->convertedCount = (size_t)frameOut;
+        session->convertedPos = 0;
+    }
+    session->throttled = false;
+}
+
+// Reads at most one buffer of audio, so events are collected between reads; the socket is level
+// triggered and reports the rest on the next pass. Returns false if the session should be closed.
+static bool read_session(Session* session) {
+    for (;;) {
+        if (!session->started) {
+            ssize_t count = read(session->fd, (unsigned char*)&session->header + session->headerFill,
+                                 sizeof(DaemonHeader) - session->headerFill);
+            if (count == 0) return false;
+            if (count < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+            session->headerFill += (size_t)count;
+            if (session->headerFill < sizeof(DaemonHeader)) continue;
+
+            const char* error = start_session(session);
+            if (error) {
+                send_error(session->fd, error);
+                return false;
+            }
+            continue;
+        }
+
+        if (session->throttled || session->inputFill == INPUT_BUFFER_BYTES) {
+            return true;
+        }
+        ssize_t count = read(session->fd, session->input + session->inputFill, INPUT_BUFFER_BYTES - session->inputFill);
+        if (count == 0) {
+            session->finished = true;
+            session->flushFrames = ma_data_converter_get_input_latency(&session->converter);
+            process_input(session);
+            return true;
+        }
+        if (count < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+        session->inputFill += (size_t)count;
+        process_input(session);
+        return true;
+    }
+}
+
+// Tells the client how many events it has lost so far, if that changed
+static void report_drops(Session* session) {
+    unsigned long long dropped = __atomic_load_n(&session->slot->droppedEvents, __ATOMIC_RELAXED);
+    if (dropped == session->reportedDrops) {
+        return;
+    }
+    session->reportedDrops = dropped;
+
+    if (session->header.eventFormat == DAEMON_EVENTS_JSON) {
+        char line[64];
+        int length = snprintf(line, sizeof(line), "{\"type\":\"dropped\",\"count\":%llu}\n", dropped);
+        append_output(session, line, (size_t)length);
+    } else {
+        DaemonEvent event;
+        memset(&event, 0, sizeof(event));
+        event.type = DAEMON_EVENT_DROPPED;
+        event.sampleIndex = dropped;
+        append_output(session, &event, sizeof(event));
+    }
+}
+
+// Leaves events in the ring while the client is behind; its input is throttled meanwhile, which
+// bounds how many more the engine produces
+static void collect_events(Session* session) {
+    DaemonEvent events[64];
+    size_t count;
+    double rateRatio = (double)session->header.sampleRate / ANALYSIS_SAMPLE_RATE;
+
+    while (session->outputFill < MAX_OUTPUT_BYTES && (count = readSpscRing(session->slot->events, events, 64)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            events[i].sampleIndex = (uint64_t)((double)events[i].sampleIndex * rateRatio + 0.5);
+            if (session->header.eventFormat == DAEMON_EVENTS_JSON) {
+                char line[160];
+                int length = formatEventJson(line, sizeof(line), (TrackerEventType)events[i].type,
+                                             events[i].sampleIndex, events[i].time, events[i].tempo);
+                if (length > 0) append_output(session, line, (size_t)length);
+            } else {
+                append_output(session, &events[i], sizeof(DaemonEvent));
+            }
+        }
+    }
+    report_drops(session);
+}
+
+// Returns false if the session should be closed
+static bool write_session(Session* session) {
+    size_t sent = 0;
+    while (sent < session->outputFill) {
+        ssize_t count = send(session->fd, session->output + sent, session->outputFill - sent, MSG_NOSIGNAL);
+        if (count < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        sent += (size_t)count;
+    }
+    memmove(session->output, session->output + sent, session->outputFill - sent);
+    session->outputFill -= sent;
+    return true;
+}
+
+// Everything the client sent has been analyzed and every event sent
+static bool session_done(Session* session) {
+    return session->finished && !session->throttled && session->flushFrames == 0 &&
+           session->convertedPos == session->convertedCount && isEngineStreamIdle(session->slot->stream) &&
+           getSpscRingReadable(session->slot->events) == 0 && session->outputFill == 0;
+}
+
+/**
+ * Main loop
+ */
+static int open_listener(const char* path) {
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        printf("Socket path is too long: %s\n", path);
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 64) != 0) {
+        printf("Could not listen on %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+static void service_sessions(Daemon* daemon, bool* needsRetry) {
+    *needsRetry = false;
+    for (int i = daemon->numSessions - 1; i >= 0; i--) {
+        Session* session = daemon->sessions[i];
+        if (!session->started) continue;
+
+        if (session->throttled) {
+            process_input(session);
+        }
+
+        collect_events(session);
+        if (session->outputFill > 0 && !write_session(session)) {
+            close_session(daemon, session);
+            continue;
+        }
+        if (session_done(session)) {
+            close_session(daemon, session);
+            continue;
+        }
+
+        if (session->throttled || session->finished) {
+            *needsRetry = true;
+        }
+        // read_session() may have throttled it since the last pass, so compare with what is registered
+        update_interest(daemon, session);
+    }
+}
+
+static void run_daemon(Daemon* daemon) {
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    bool needsRetry = false;
+
+    while (!stopRequested) {
+        int count = epoll_wait(daemon->epollFd, events, MAX_EPOLL_EVENTS, needsRetry ? RETRY_MILLISECONDS : -1);
+        if (count < 0 && errno != EINTR) {
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (events[i].data.ptr == &daemon->listenFd) {
+                accept_session(daemon);
+            } else if (events[i].data.ptr == &daemon->wakeFd) {
+                uint64_t value;
+                ssize_t bytes = read(daemon->wakeFd, &value, sizeof(value));
+                (void)bytes;
+            } else {
+                Session* session = (Session*)events[i].data.ptr;
+                if ((events[i].events & (EPOLLERR | EPOLLHUP)) && !(events[i].events & EPOLLIN)) {
+                    close_session(daemon, session);
+                    // Later entries of this batch may point at the freed session
+                    break;
+                }
+                if ((events[i].events & EPOLLIN) && !read_session(session)) {
+                    close_session(daemon, session);
+                    break;
+                }
+            }
+        }
+
+        service_sessions(daemon, &needsRetry);
+    }
+}
+
+static void print_usage(const char* program) {
+    printf("Usage: %s [--socket path] [--max-sessions n] [--pool n] [-j workers] [-i parameter=value ...]\n", program);
+    printf("Listens on a Unix socket (default %s) and tracks tempo, beats and onsets on raw PCM\n", DAEMON_DEFAULT_SOCKET);
+    printf("streams from any number of clients; see daemon_protocol.h for the wire format.\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* socketPath = DAEMON_DEFAULT_SOCKET;
+    Daemon daemon;
+    memset(&daemon, 0, sizeof(daemon));
+    daemon.maxSessions = DEFAULT_MAX_SESSIONS;
+    daemon.poolSize = DEFAULT_POOL_SIZE;
+    EngineConfig config = engineConfigInit();
+
+    collect_parameters(&daemon.parameters, argc, argv);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            i++;  // already handled by collect_parameters
+        } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (strcmp(argv[i], "--max-sessions") == 0 && i + 1 < argc) {
+            daemon.maxSessions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--pool") == 0 && i + 1 < argc) {
+            daemon.poolSize = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            config.numWorkers = atoi(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0 ? 0 : 1;
+        }
+    }
+    if (daemon.maxSessions < 1) daemon.maxSessions = 1;
+    if (daemon.poolSize > daemon.maxSessions) daemon.poolSize = daemon.maxSessions;
+
+    daemon.listenFd = open_listener(socketPath);
+    if (daemon.listenFd < 0) {
+        return 1;
+    }
+    daemon.engine = createEngine(&config);
+    daemon.epollFd = epoll_create1(0);
+    daemon.wakeFd = eventfd(0, EFD_NONBLOCK);
+    daemon.sessions = (Session**)calloc(daemon.maxSessions, sizeof(Session*));
+    daemon.pool = (Slot**)calloc(daemon.poolSize > 0 ? daemon.poolSize : 1, sizeof(Slot*));
+    refill_pool(&daemon);
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = &daemon.listenFd;
+    epoll_ctl(daemon.epollFd, EPOLL_CTL_ADD, daemon.listenFd, &event);
+    event.data.ptr = &daemon.wakeFd;
+    epoll_ctl(daemon.epollFd, EPOLL_CTL_ADD, daemon.wakeFd, &event);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    signal(SIGPIPE, SIG_IGN);
+    printf("Listening on %s\n", socketPath);
+    fflush(stdout);
+
+    run_daemon(&daemon);
+
+    while (daemon.numSessions > 0) {
+        close_session(&daemon, daemon.sessions[0]);
+    }
+    while (daemon.poolCount > 0) {
+        destroy_slot(&daemon, daemon.pool[--daemon.poolCount]);
+    }
+    destroyEngine(daemon.engine);
+    close(daemon.listenFd);
+    close(daemon.epollFd);
+    close(daemon.wakeFd);
+    unlink(socketPath);
+    free(daemon.sessions);
+    free(daemon.pool);
+    return 0;
+}
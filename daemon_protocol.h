@@ -0,0 +1,49 @@
+#ifndef DAEMON_PROTOCOL_H
+#define DAEMON_PROTOCOL_H
+
+#include <stdint.h>
+
+// Wire format of tempotest_daemon. The socket is local, so everything is in host byte order.
+//
+// A client connects, sends one DaemonHeader followed by raw interleaved PCM, and reads events
+// back until it closes its side (shutdown(SHUT_WR)), after which the daemon sends the events
+// for the remaining audio and closes the connection. Errors are reported as a single JSON
+// line, {"error":"..."}, before the daemon closes the connection.
+//
+// A client that stops reading its events stops being read from until it catches up. If events
+// are lost anyway, the daemon sends {"type":"dropped","count":n} (or a DaemonEvent of type
+// DAEMON_EVENT_DROPPED with the count in sampleIndex) with the total lost so far.
+
+#define DAEMON_MAGIC 0x31535454u    // "TTS1"
+#define DAEMON_DEFAULT_SOCKET "/tmp/tempotest.sock"
+
+typedef enum {
+    DAEMON_FORMAT_F32 = 0,
+    DAEMON_FORMAT_S16 = 1
+} DaemonSampleFormat;
+
+typedef enum {
+    DAEMON_EVENTS_BINARY = 0,   // DaemonEvent frames
+    DAEMON_EVENTS_JSON = 1      // formatEventJson() lines
+} DaemonEventFormat;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t sampleRate;
+    uint16_t channels;
+    uint8_t format;             // DaemonSampleFormat
+    uint8_t eventFormat;        // DaemonEventFormat
+    uint32_t reserved;
+} DaemonHeader;
+
+#define DAEMON_EVENT_DROPPED 0xffu
+
+typedef struct {
+    uint32_t type;              // TrackerEventType or DAEMON_EVENT_DROPPED
+    uint32_t reserved;
+    uint64_t sampleIndex;       // in frames of the client's audio
+    double time;                // seconds from the start of the stream
+    double tempo;               // BPM
+} DaemonEvent;
+
+#endif // DAEMON_PROTOCOL_H
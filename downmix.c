@@ -0,0 +1,26 @@
+#include "downmix.h"
+
+void downmixToMono(const float* in, float* out, size_t frameCount, int channels) {
+    if (channels == 1) {
+        if (out != in) {
+            for (size_t i = 0; i < frameCount; i++) out[i] = in[i];
+        }
+        return;
+    }
+
+    if (channels == 2) {
+        for (size_t i = 0; i < frameCount; i++) {
+            out[i] = 0.5f * (in[2 * i] + in[2 * i + 1]);
+        }
+        return;
+    }
+
+    float scale = 1.0f / (float)channels;
+    for (size_t i = 0; i < frameCount; i++) {
+        float sum = 0;
+        for (int c = 0; c < channels; c++) {
+            sum += in[i * channels + c];
+        }
+        out[i] = sum * scale;
+    }
+}
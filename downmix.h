@@ -0,0 +1,9 @@
+#ifndef DOWNMIX_H
+#define DOWNMIX_H
+
+#include <stddef.h>
+
+// Averages interleaved frames down to one channel. out may alias in.
+void downmixToMono(const float* in, float* out, size_t frameCount, int channels);
+
+#endif // DOWNMIX_H
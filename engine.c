@@ -0,0 +1,345 @@
+#include "engine.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "timing.h"
+
+#define ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ATOMIC_ADD(p, v) __atomic_add_fetch((p), (v), __ATOMIC_ACQ_REL)
+
+struct EngineStream {
+    Engine* engine;
+    Tracker* tracker;
+    SpscRing* ring;
+    float* scratch;
+    int homeWorker;
+    int scheduled;          // set while the stream sits in a queue or is being analyzed
+    int removing;
+    double readySince;
+    unsigned long long framesDropped;
+
+    pthread_mutex_t statsMutex;
+    pthread_cond_t drained;
+    EngineStreamStats stats;
+};
+
+typedef struct {
+    EngineStream** items;
+    int head;
+    int count;
+    int capacity;
+    pthread_mutex_t mutex;
+} StreamQueue;
+
+struct Engine {
+    EngineConfig config;
+    pthread_t* threads;
+    int numThreads;
+    StreamQueue* queues;    // one per worker
+    int nextWorker;
+    int queued;             // streams waiting in any queue
+    bool running;
+    pthread_mutex_t mutex;
+    pthread_cond_t workAvailable;
+};
+
+typedef struct {
+    Engine* engine;
+    int index;
+} WorkerArg;
+
+EngineConfig engineConfigInit(void) {
+    EngineConfig config;
+    config.numWorkers = 4;
+    config.hopFrames = 1024;
+    config.quantumHops = 4;
+    config.ringFrames = 44100 * 2;
+    return config;
+}
+
+/**
+ * Per-worker queues. The owner takes from the front, thieves from the back.
+ */
+static void queue_init(StreamQueue* queue) {
+    queue->items = NULL;
+    queue->head = queue->count = queue->capacity = 0;
+    pthread_mutex_init(&queue->mutex, NULL);
+}
+
+static void queue_push_back(StreamQueue* queue, EngineStream* stream) {
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->count == queue->capacity) {
+        int capacity = queue->capacity ? queue->capacity * 2 : 16;
+        EngineStream** items = (EngineStream**)malloc(capacity * sizeof(EngineStream*));
+        for (int i = 0; i < queue->count; i++) {
+            items[i] = queue->items[(queue->head + i) % queue->capacity];
+        }
+        free(queue->items);
+        queue->items = items;
+        queue->head = 0;
+        queue->capacity = capacity;
+    }
+    queue->items[(queue->head + queue->count) % queue->capacity] = stream;
+    queue->count++;
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+static EngineStream* queue_pop_front(StreamQueue* queue) {
+    EngineStream* stream = NULL;
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->count > 0) {
+        stream = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return stream;
+}
+
+static EngineStream* queue_steal_back(StreamQueue* queue) {
+    EngineStream* stream = NULL;
+    // A busy victim is skipped rather than waited for
+    if (pthread_mutex_trylock(&queue->mutex) != 0) {
+        return NULL;
+    }
+    if (queue->count > 0) {
+        queue->count--;
+        stream = queue->items[(queue->head + queue->count) % queue->capacity];
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return stream;
+}
+
+static void schedule_stream(Engine* engine, EngineStream* stream, int worker) {
+    stream->readySince = getMonotonicTime();
+    queue_push_back(&engine->queues[worker], stream);
+
+    pthread_mutex_lock(&engine->mutex);
+    engine->queued++;
+    pthread_cond_signal(&engine->workAvailable);
+    pthread_mutex_unlock(&engine->mutex);
+}
+
+// Schedules the stream unless it is already queued or being analyzed
+static void try_schedule(Engine* engine, EngineStream* stream) {
+    if (ATOMIC_LOAD(&stream->removing)) return;
+    if ((int)getSpscRingReadable(stream->ring) < engine->config.hopFrames) return;
+
+    int expected = 0;
+    if (__atomic_compare_exchange_n(&stream->scheduled, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        schedule_stream(engine, stream, stream->homeWorker);
+    }
+}
+
+static EngineStream* take_work(Engine* engine, int worker) {
+    EngineStream* stream = queue_pop_front(&engine->queues[worker]);
+    int numQueues = engine->config.numWorkers;
+    for (int i = 1; !stream && i < numQueues; i++) {
+        stream = queue_steal_back(&engine->queues[(worker + i) % numQueues]);
+    }
+    if (stream) {
+        pthread_mutex_lock(&engine->mutex);
+        engine->queued--;
+        pthread_mutex_unlock(&engine->mutex);
+    }
+    return stream;
+}
+
+static void record_turn(EngineStream* stream, unsigned long long frames, double latency) {
+    pthread_mutex_lock(&stream->statsMutex);
+    EngineStreamStats* stats = &stream->stats;
+    stats->framesAnalyzed += frames;
+    stats->turns++;
+    stats->meanLatency += (latency - stats->meanLatency) / (double)stats->turns;
+    if (latency > stats->maxLatency) stats->maxLatency = latency;
+    pthread_mutex_unlock(&stream->statsMutex);
+}
+
+static void run_turn(Engine* engine, EngineStream* stream, int worker) {
+    int hop = engine->config.hopFrames;
+    size_t frames = 0;
+
+    if (!ATOMIC_LOAD(&stream->removing)) {
+        for (int h = 0; h < engine->config.quantumHops; h++) {
+            if ((int)getSpscRingReadable(stream->ring) < hop) break;
+            readSpscRing(stream->ring, stream->scratch, hop);
+            processTrackerAudio(stream->tracker, stream->scratch, hop);
+            frames += hop;
+        }
+        record_turn(stream, frames, getMonotonicTime() - stream->readySince);
+    }
+
+    if (!ATOMIC_LOAD(&stream->removing) && (int)getSpscRingReadable(stream->ring) >= hop) {
+        // Still busy: back of this worker's queue, behind everyone who has been waiting
+        schedule_stream(engine, stream, worker);
+        return;
+    }
+
+    // Held so that removeEngineStream() cannot free the stream before we are done with it
+    pthread_mutex_lock(&stream->statsMutex);
+    ATOMIC_STORE(&stream->scheduled, 0);
+    // The producer may have filled a hop between our last check and clearing the flag
+    try_schedule(engine, stream);
+    pthread_cond_broadcast(&stream->drained);
+    pthread_mutex_unlock(&stream->statsMutex);
+}
+
+static void* engine_worker(void* arg) {
+    WorkerArg* workerArg = (WorkerArg*)arg;
+    Engine* engine = workerArg->engine;
+    int worker = workerArg->index;
+    free(workerArg);
+
+    for (;;) {
+        EngineStream* stream = take_work(engine, worker);
+        if (stream) {
+            run_turn(engine, stream, worker);
+            continue;
+        }
+
+        pthread_mutex_lock(&engine->mutex);
+        while (engine->running && engine->queued == 0) {
+            pthread_cond_wait(&engine->workAvailable, &engine->mutex);
+        }
+        bool running = engine->running;
+        pthread_mutex_unlock(&engine->mutex);
+        if (!running) break;
+    }
+
+    return NULL;
+}
+
+Engine* createEngine(const EngineConfig* config) {
+    Engine* engine = (Engine*)calloc(1, sizeof(Engine));
+    engine->config = config ? *config : engineConfigInit();
+    if (engine->config.numWorkers < 1) engine->config.numWorkers = 1;
+    if (engine->config.quantumHops < 1) engine->config.quantumHops = 1;
+    if (engine->config.ringFrames < engine->config.hopFrames * 2) engine->config.ringFrames = engine->config.hopFrames * 2;
+
+    engine->running = true;
+    pthread_mutex_init(&engine->mutex, NULL);
+    pthread_cond_init(&engine->workAvailable, NULL);
+
+    engine->queues = (StreamQueue*)malloc(engine->config.numWorkers * sizeof(StreamQueue));
+    for (int i = 0; i < engine->config.numWorkers; i++) {
+        queue_init(&engine->queues[i]);
+    }
+
+    engine->threads = (pthread_t*)malloc(engine->config.numWorkers * sizeof(pthread_t));
+    for (int i = 0; i < engine->config.numWorkers; i++) {
+        WorkerArg* arg = (WorkerArg*)malloc(sizeof(WorkerArg));
+        arg->engine = engine;
+        arg->index = i;
+        if (pthread_create(&engine->threads[engine->numThreads], NULL, engine_worker, arg) != 0) {
+            free(arg);
+            break;
+        }
+        engine->numThreads++;
+    }
+
+    if (engine->numThreads == 0) {
+        destroyEngine(engine);
+        return NULL;
+    }
+    return engine;
+}
+
+void destroyEngine(Engine* engine) {
+    pthread_mutex_lock(&engine->mutex);
+    engine->running = false;
+    pthread_cond_broadcast(&engine->workAvailable);
+    pthread_mutex_unlock(&engine->mutex);
+
+    for (int i = 0; i < engine->numThreads; i++) {
+        pthread_join(engine->threads[i], NULL);
+    }
+
+    for (int i = 0; i < engine->config.numWorkers; i++) {
+        free(engine->queues[i].items);
+        pthread_mutex_destroy(&engine->queues[i].mutex);
+    }
+    free(engine->queues);
+    free(engine->threads);
+    pthread_mutex_destroy(&engine->mutex);
+    pthread_cond_destroy(&engine->workAvailable);
+    free(engine);
+}
+
+EngineStream* addEngineStream(Engine* engine, const ParameterSet* parameters,
+                              TrackerEventCallback callback, void* userData) {
+    Tracker* tracker = createTracker(BTT_ONSET_AND_TEMPO_AND_BEAT_TRACKING, parameters);
+    if (!tracker) {
+        return NULL;
+    }
+    setTrackerEventCallback(tracker, callback, userData);
+
+    EngineStream* stream = (EngineStream*)calloc(1, sizeof(EngineStream));
+    stream->engine = engine;
+    stream->tracker = tracker;
+    stream->ring = createSpscRing(engine->config.ringFrames, sizeof(float));
+    stream->scratch = (float*)malloc(engine->config.hopFrames * sizeof(float));
+    pthread_mutex_init(&stream->statsMutex, NULL);
+    pthread_cond_init(&stream->drained, NULL);
+
+    // Spread home queues round robin; stealing evens out whatever imbalance remains
+    pthread_mutex_lock(&engine->mutex);
+    stream->homeWorker = engine->nextWorker;
+    engine->nextWorker = (engine->nextWorker + 1) % engine->numThreads;
+    pthread_mutex_unlock(&engine->mutex);
+
+    return stream;
+}
+
+void removeEngineStream(Engine* engine, EngineStream* stream) {
+    (void)engine;
+    ATOMIC_STORE(&stream->removing, 1);
+
+    // Wait for a worker to drop the stream if it is queued or being analyzed
+    pthread_mutex_lock(&stream->statsMutex);
+    while (ATOMIC_LOAD(&stream->scheduled)) {
+        pthread_cond_wait(&stream->drained, &stream->statsMutex);
+    }
+    pthread_mutex_unlock(&stream->statsMutex);
+
+    destroyTracker(stream->tracker);
+    destroySpscRing(stream->ring);
+    free(stream->scratch);
+    pthread_mutex_destroy(&stream->statsMutex);
+    pthread_cond_destroy(&stream->drained);
+    free(stream);
+}
+
+size_t writeEngineStream(EngineStream* stream, const float* samples, size_t frameCount) {
+    size_t written = writeSpscRing(stream->ring, samples, frameCount);
+    if (written < frameCount) {
+        ATOMIC_ADD(&stream->framesDropped, (unsigned long long)(frameCount - written));
+    }
+    try_schedule(stream->engine, stream);
+    return written;
+}
+
+void getEngineStreamStats(EngineStream* stream, EngineStreamStats* stats) {
+    pthread_mutex_lock(&stream->statsMutex);
+    *stats = stream->stats;
+    pthread_mutex_unlock(&stream->statsMutex);
+    stats->framesDropped = ATOMIC_LOAD(&stream->framesDropped);
+}
+
+double getEngineStreamTempo(EngineStream* stream) {
+    return stream->tracker->tempo;
+}
+
+bool isEngineStreamIdle(EngineStream* stream) {
+    return !ATOMIC_LOAD(&stream->scheduled) && (int)getSpscRingReadable(stream->ring) < stream->engine->config.hopFrames;
+}
+
+void drainEngineStream(EngineStream* stream) {
+    int hop = stream->engine->config.hopFrames;
+    pthread_mutex_lock(&stream->statsMutex);
+    while (ATOMIC_LOAD(&stream->scheduled) || (int)getSpscRingReadable(stream->ring) >= hop) {
+        pthread_cond_wait(&stream->drained, &stream->statsMutex);
+    }
+    pthread_mutex_unlock(&stream->statsMutex);
+}
@@ -0,0 +1,56 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "parameters.h"
+#include "spsc_ring.h"
+#include "tracker.h"
+
+// Tracks tempo on many independent streams with a fixed pool of worker threads. Each stream
+// has its own BTT (through a Tracker) and input ring. A stream is scheduled once it holds a
+// full hop; a worker analyzes at most one quantum of it and puts it at the back of the queue
+// if more is waiting, so a busy stream cannot starve the others. Idle workers steal
+// scheduled streams from the other workers' queues.
+
+typedef struct {
+    int numWorkers;
+    int hopFrames;          // a stream is ready once this much audio is buffered
+    int quantumHops;        // hops analyzed per turn before yielding to other streams
+    int ringFrames;         // per-stream input buffer
+} EngineConfig;
+
+typedef struct {
+    unsigned long long framesAnalyzed;
+    unsigned long long framesDropped;   // writes that did not fit into the ring
+    unsigned long long turns;
+    double meanLatency;     // seconds from a hop being ready to it being analyzed
+    double maxLatency;
+} EngineStreamStats;
+
+typedef struct Engine Engine;
+typedef struct EngineStream EngineStream;
+
+EngineConfig engineConfigInit(void);
+Engine* createEngine(const EngineConfig* config);
+// Stops the workers. Streams must be removed first.
+void destroyEngine(Engine* engine);
+
+// callback runs on a worker thread, but never concurrently for the same stream
+EngineStream* addEngineStream(Engine* engine, const ParameterSet* parameters,
+                              TrackerEventCallback callback, void* userData);
+// The producer must have stopped writing to the stream before it is removed
+void removeEngineStream(Engine* engine, EngineStream* stream);
+
+// Called by the stream's single producer. Does not block; returns the frames accepted.
+size_t writeEngineStream(EngineStream* stream, const float* samples, size_t frameCount);
+void getEngineStreamStats(EngineStream* stream, EngineStreamStats* stats);
+double getEngineStreamTempo(EngineStream* stream);
+// True when the stream is not being analyzed and holds less than a full hop
+bool isEngineStreamIdle(EngineStream* stream);
+// Blocks until everything written to the stream so far has been analyzed, except for a
+// final partial hop
+void drainEngineStream(EngineStream* stream);
+
+#endif // ENGINE_H
@@ -0,0 +1,345 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "analysis.h"
+#include "audio_decode.h"
+#include "batch.h"
+#include "beat_metrics.h"
+#include "journal.h"
+#include "parameters.h"
+
+#define DEFAULT_SYNC_INTERVAL 16
+
+typedef struct {
+    int evaluated;
+    int hasBeats;
+    int hasTempo;
+    double estimatedTempo;
+    BeatScores scores;
+} FileResult;
+
+typedef struct {
+    const char* cacheDir;
+    ParameterSet parameters;
+    FileResult* results;
+    Journal* journal;
+} EvalContext;
+
+static int read_annotation(const char* path, double** values) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+
+    int count = 0, capacity = 256;
+    *values = (double*)malloc(capacity * sizeof(double));
+
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char* end;
+        double value = strtod(line, &end);
+        if (end == line) continue;  // comments and blank lines
+
+        if (count == capacity) {
+            capacity *= 2;
+            *values = (double*)realloc(*values, capacity * sizeof(double));
+        }
+        (*values)[count++] = value;
+    }
+    fclose(file);
+    return count;
+}
+
+// "song.wav" -> "song.beats"
+static void annotation_path(const char* audioPath, const char* extension, char* out, size_t outSize) {
+    snprintf(out, outSize, "%s", audioPath);
+    char* dot = strrchr(out, '.');
+    char* slash = strrchr(out, '/');
+    if (dot && (!slash || dot > slash)) *dot = '\0';
+    strncat(out, extension, outSize - strlen(out) - 1);
+}
+
+static int is_tempo_score(int index) {
+    return index >= 5;  // acc1, acc2
+}
+
+// One tab separated line per file; this is both the report row and the journal record
+static void format_result(const char* path, const FileResult* result, char* out, size_t outSize) {
+    size_t length = (size_t)snprintf(out, outSize, "%s", path);
+    for (int s = 0; s < NUM_BEAT_SCORES && length < outSize; s++) {
+        int available = is_tempo_score(s) ? result->hasTempo : result->hasBeats;
+        if (available) {
+            length += (size_t)snprintf(out + length, outSize - length, "\t%.4f", beatScoreAt(&result->scores, s));
+        } else {
+            length += (size_t)snprintf(out + length, outSize - length, "\t-");
+        }
+    }
+    if (length < outSize) {
+        snprintf(out + length, outSize - length, "\t%.2f", result->estimatedTempo);
+    }
+}
+
+static int parse_result(const char* line, FileResult* result) {
+    double values[NUM_BEAT_SCORES];
+    memset(result, 0, sizeof(*result));
+
+    const char* field = strchr(line, '\t');
+    for (int s = 0; s < NUM_BEAT_SCORES; s++) {
+        if (!field) return -1;
+        field++;
+        if (*field == '-') {
+            values[s] = 0;
+        } else {
+            values[s] = strtod(field, NULL);
+            if (is_tempo_score(s)) result->hasTempo = 1;
+            else result->hasBeats = 1;
+        }
+        field = strchr(field, '\t');
+    }
+    if (!field) return -1;
+    result->estimatedTempo = strtod(field + 1, NULL);
+
+    result->scores.fMeasure = values[0];
+    result->scores.cemgil = values[1];
+    result->scores.pScore = values[2];
+    result->scores.cmlt = values[3];
+    result->scores.amlt = values[4];
+    result->scores.acc1 = values[5];
+    result->scores.acc2 = values[6];
+    result->evaluated = 1;
+    return 0;
+}
+
+static void evaluate_file(int index, const char* path, void* userData) {
+    EvalContext* context = (EvalContext*)userData;
+    FileResult* result = &context->results[index];
+    char annotationFile[4096];
+
+    // Finished in an earlier run, already loaded from the journal
+    if (result->evaluated) {
+        return;
+    }
+
+    double* referenceBeats = NULL;
+    annotation_path(path, ".beats", annotationFile, sizeof(annotationFile));
+    int numReferenceBeats = read_annotation(annotationFile, &referenceBeats);
+
+    double* referenceTempos = NULL;
+    annotation_path(path, ".bpm", annotationFile, sizeof(annotationFile));
+    int numReferenceTempos = read_annotation(annotationFile, &referenceTempos);
+
+    if (numReferenceBeats <= 0 && numReferenceTempos <= 0) {
+        fprintf(stderr, "No annotations for %s, skipping\n", path);
+        free(referenceBeats);
+        free(referenceTempos);
+        return;
+    }
+
+    DecodedAudio audio;
+    if (decodeAudioFile(path, ANALYSIS_SAMPLE_RATE, context->cacheDir, &audio) != 0) {
+        fprintf(stderr, "Could not load file: %s\n", path);
+        free(referenceBeats);
+        free(referenceTempos);
+        return;
+    }
+
+    AnalysisResult analysis;
+    if (analyzeBuffer(audio.samples, audio.frameCount, &context->parameters, &analysis) == 0) {
+        double referenceTempo = (numReferenceTempos > 0) ? referenceTempos[0] : 0;
+        computeBeatScores(referenceBeats, numReferenceBeats > 0 ? numReferenceBeats : 0,
+                          analysis.beats, analysis.numBeats,
+                          referenceTempo, analysis.tempo, &result->scores);
+        result->hasBeats = numReferenceBeats > 0;
+        result->hasTempo = numReferenceTempos > 0 || numReferenceBeats > 1;
+        result->estimatedTempo = analysis.tempo;
+        result->evaluated = 1;
+        freeAnalysisResult(&analysis);
+
+        if (context->journal) {
+            char line[8192];
+            format_result(path, result, line, sizeof(line));
+            appendToJournal(context->journal, line);
+        }
+    }
+
+    fprintf(stderr, "Evaluated %s\n", path);
+    freeDecodedAudio(&audio);
+    free(referenceBeats);
+    free(referenceTempos);
+}
+
+static void print_results(char* const* paths, const FileResult* results, int count) {
+    double sums[NUM_BEAT_SCORES] = {0};
+    int counts[NUM_BEAT_SCORES] = {0};
+    char line[8192];
+
+    printf("file");
+    for (int s = 0; s < NUM_BEAT_SCORES; s++) printf("\t%s", BEAT_SCORE_NAMES[s]);
+    printf("\ttempo\n");
+
+    for (int i = 0; i < count; i++) {
+        const FileResult* result = &results[i];
+        if (!result->evaluated) continue;
+
+        format_result(paths[i], result, line, sizeof(line));
+        printf("%s\n", line);
+
+        for (int s = 0; s < NUM_BEAT_SCORES; s++) {
+            if (is_tempo_score(s) ? result->hasTempo : result->hasBeats) {
+                sums[s] += beatScoreAt(&result->scores, s);
+                counts[s]++;
+            }
+        }
+    }
+
+    printf("mean");
+    for (int s = 0; s < NUM_BEAT_SCORES; s++) {
+        if (counts[s] > 0) printf("\t%.4f", sums[s] / counts[s]);
+        else printf("\t-");
+    }
+    printf("\t-\n");
+}
+
+// Combines the journals of several shards into one report. Entries are ordered by path and
+// a file that shows up in more than one journal is counted once.
+static int merge_journals(int count, char** journalPaths) {
+    FileList files = {0};
+    FileResult* results = NULL;
+    int capacity = 0;
+
+    for (int j = 0; j < count; j++) {
+        Journal* journal = readJournal(journalPaths[j]);
+        if (!journal) {
+            fprintf(stderr, "Could not open journal: %s\n", journalPaths[j]);
+            continue;
+        }
+        for (int e = 0; e < journal->count; e++) {
+            if (files.count == capacity) {
+                capacity = capacity ? capacity * 2 : 256;
+                results = (FileResult*)realloc(results, capacity * sizeof(FileResult));
+            }
+            if (parse_result(journal->entries[e].line, &results[files.count]) != 0) continue;
+
+            // addAudioFiles() would stat the path, which need not exist on this machine
+            if (files.count == files.capacity) {
+                files.capacity = files.capacity ? files.capacity * 2 : 256;
+                files.paths = (char**)realloc(files.paths, files.capacity * sizeof(char*));
+            }
+            files.paths[files.count++] = strdup(journal->entries[e].line);
+        }
+        closeJournal(journal);
+    }
+
+    // Sort the raw lines, then drop repeated paths and reparse in the new order
+    sortFileList(&files);
+    int unique = 0;
+    for (int i = 0; i < files.count; i++) {
+        char* tab = strchr(files.paths[i], '\t');
+        parse_result(files.paths[i], &results[unique]);
+        *tab = '\0';
+        if (unique > 0 && strcmp(files.paths[unique - 1], files.paths[i]) == 0) {
+            free(files.paths[i]);
+            continue;
+        }
+        files.paths[unique++] = files.paths[i];
+    }
+    files.count = unique;
+
+    print_results(files.paths, results, files.count);
+    free(results);
+    freeFileList(&files);
+    return 0;
+}
+
+static int default_thread_count(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count > 0) return (int)count;
+#endif
+    return 4;
+}
+
+static void print_usage(const char* program) {
+    printf("Usage: %s [-j threads] [--cache-dir dir] [--shard i/n] [--journal file [--sync-every n]]\n"
+           "       [-i parameter=value ...] <audio file or directory>...\n", program);
+    printf("       %s --merge <journal>...\n", program);
+    printf("Reference annotations are read from <name>.beats (one beat time in seconds per line)\n");
+    printf("and <name>.bpm (tempo in BPM) next to each audio file.\n");
+    printf("With --journal, finished files are appended to the journal and skipped when the run is\n");
+    printf("restarted. --shard i/n evaluates every n-th file starting at i (0 <= i < n).\n");
+}
+
+int main(int argc, char* argv[]) {
+    EvalContext context = {0};
+    FileList files = {0};
+    int numThreads = default_thread_count();
+    int shardIndex = 0, shardCount = 1;
+    int syncInterval = DEFAULT_SYNC_INTERVAL;
+    const char* journalPath = NULL;
+
+    if (argc >= 2 && strcmp(argv[1], "--merge") == 0) {
+        return merge_journals(argc - 2, argv + 2);
+    }
+
+    collect_parameters(&context.parameters, argc, argv);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            i++;  // already handled by collect_parameters
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            numThreads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc) {
+            context.cacheDir = argv[++i];
+        } else if (strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+            if (parseShard(argv[++i], &shardIndex, &shardCount) != 0) {
+                printf("Invalid shard: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc) {
+            journalPath = argv[++i];
+        } else if (strcmp(argv[i], "--sync-every") == 0 && i + 1 < argc) {
+            syncInterval = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            addAudioFiles(&files, argv[i]);
+        }
+    }
+
+    if (files.count == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    sortFileList(&files);
+    selectShard(&files, shardIndex, shardCount);
+
+    context.results = (FileResult*)calloc(files.count, sizeof(FileResult));
+
+    if (journalPath) {
+        context.journal = openJournal(journalPath, syncInterval);
+        if (!context.journal) {
+            printf("Could not open journal: %s\n", journalPath);
+            free(context.results);
+            freeFileList(&files);
+            return 1;
+        }
+
+        int resumed = 0;
+        for (int i = 0; i < files.count; i++) {
+            const JournalEntry* entry = findJournalEntry(context.journal, files.paths[i]);
+            if (entry && parse_result(entry->line, &context.results[i]) == 0) resumed++;
+        }
+        if (resumed > 0) fprintf(stderr, "Resuming, %d of %d files already done\n", resumed, files.count);
+    }
+
+    runBatch(&files, numThreads, evaluate_file, &context);
+    print_results(files.paths, context.results, files.count);
+
+    if (context.journal) closeJournal(context.journal);
+    free(context.results);
+    freeFileList(&files);
+    return 0;
+}
@@ -0,0 +1,18 @@
+#include "event_format.h"
+#include <stdio.h>
+
+const char* trackerEventName(TrackerEventType type) {
+    switch (type) {
+        case TRACKER_EVENT_ONSET: return "onset";
+        case TRACKER_EVENT_BEAT: return "beat";
+        case TRACKER_EVENT_TEMPO: return "tempo";
+    }
+    return "unknown";
+}
+
+int formatEventJson(char* out, size_t outSize, TrackerEventType type, unsigned long long sampleIndex,
+                    double time, double tempo) {
+    int length = snprintf(out, outSize, "{\"type\":\"%s\",\"sample\":%llu,\"time\":%.6f,\"tempo\":%.2f}\n",
+                          trackerEventName(type), sampleIndex, time, tempo);
+    return (length < 0 || (size_t)length >= outSize) ? -1 : length;
+}
@@ -0,0 +1,16 @@
+#ifndef EVENT_FORMAT_H
+#define EVENT_FORMAT_H
+
+#include <stddef.h>
+
+#include "tracker.h"
+
+const char* trackerEventName(TrackerEventType type);
+
+// One JSON object and a newline, e.g.
+//   {"type":"beat","sample":88200,"time":2.000000,"tempo":120.00}
+// Returns the length written, excluding the NUL, or -1 if out is too small.
+int formatEventJson(char* out, size_t outSize, TrackerEventType type, unsigned long long sampleIndex,
+                    double time, double tempo);
+
+#endif // EVENT_FORMAT_H
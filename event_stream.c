@@ -0,0 +1,53 @@
+#include "event_stream.h"
+#include <stdlib.h>
+
+EventStream* createEventStream(size_t capacity, double sampleRate) {
+    EventStream* stream = (EventStream*)calloc(1, sizeof(EventStream));
+    stream->ring = createSpscRing(capacity, sizeof(StreamEvent));
+    stream->sampleRate = sampleRate;
+    stream->analysisDelayFrames = EVENT_STREAM_ANALYSIS_DELAY_FRAMES;
+    return stream;
+}
+
+void destroyEventStream(EventStream* stream) {
+    destroySpscRing(stream->ring);
+    free(stream);
+}
+
+void setEventStreamLatency(EventStream* stream, double deviceLatency, int analysisDelayFrames) {
+    __atomic_store(&stream->deviceLatency, &deviceLatency, __ATOMIC_RELAXED);
+    __atomic_store_n(&stream->analysisDelayFrames, analysisDelayFrames, __ATOMIC_RELAXED);
+}
+
+void eventStreamCallback(const TrackerEvent* event, void* userData) {
+    EventStream* stream = (EventStream*)userData;
+    double deviceLatency;
+    __atomic_load(&stream->deviceLatency, &deviceLatency, __ATOMIC_RELAXED);
+    int analysisDelayFrames = __atomic_load_n(&stream->analysisDelayFrames, __ATOMIC_RELAXED);
+
+    StreamEvent streamEvent;
+    streamEvent.type = event->type;
+    streamEvent.tempo = event->tempo;
+    streamEvent.strength = event->type == TRACKER_EVENT_TEMPO ? 0 : event->level;
+
+    // Tempo changes are stamped with the end of the block, not a detection, so only onsets
+    // and beats are moved back by the analysis delay
+    unsigned long long delay = event->type == TRACKER_EVENT_TEMPO ? 0 : (unsigned long long)analysisDelayFrames;
+    streamEvent.sampleIndex = event->sampleIndex > delay ? event->sampleIndex - delay : 0;
+    double shift = (double)(event->sampleIndex - streamEvent.sampleIndex) / stream->sampleRate;
+
+    if (event->arrivalTime > 0) {
+        streamEvent.streamTime = event->arrivalTime - shift + deviceLatency;
+    } else {
+        streamEvent.streamTime = (double)streamEvent.sampleIndex / stream->sampleRate;
+    }
+
+    // Never block the analysis thread; a reader that falls behind loses the newest events
+    if (writeSpscRing(stream->ring, &streamEvent, 1) == 0) {
+        __atomic_add_fetch(&stream->dropped, 1, __ATOMIC_RELAXED);
+    }
+}
+
+size_t readEventStream(EventStream* stream, StreamEvent* events, size_t maxEvents) {
+    return readSpscRing(stream->ring, events, maxEvents);
+}
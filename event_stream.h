@@ -0,0 +1,50 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <stddef.h>
+
+#include "spsc_ring.h"
+#include "tracker.h"
+
+// BTT reports an onset once the frames around it have gone through the STFT and the OSS
+// filter: half a window plus the filter's group delay after it happened.
+#define EVENT_STREAM_HOP_FRAMES (BTT_SUGGESTED_SPECTRAL_FLUX_STFT_LEN / BTT_SUGGESTED_SPECTRAL_FLUX_STFT_OVERLAP)
+#define EVENT_STREAM_ANALYSIS_DELAY_FRAMES \
+    (BTT_SUGGESTED_SPECTRAL_FLUX_STFT_LEN / 2 + BTT_SUGGESTED_OSS_FILTER_ORDER * EVENT_STREAM_HOP_FRAMES / 2)
+
+typedef struct {
+    TrackerEventType type;
+    unsigned long long sampleIndex; // compensated for the analysis delay
+    double streamTime;              // getMonotonicTime() at which the event is audible (playback)
+                                    // or reached the input (capture); sampleIndex in seconds for
+                                    // offline analysis
+    float strength;                 // peak level around the event, 0 for tempo changes
+    double tempo;
+} StreamEvent;
+
+// Lock-free queue of tracker events with latency compensated times. The tracker thread is the
+// only producer (install eventStreamCallback(), or call it from another callback) and one
+// other thread, usually the UI or an output, reads.
+typedef struct {
+    SpscRing* ring;
+    double sampleRate;
+    double deviceLatency;       // seconds, see setEventStreamLatency(); atomic
+    int analysisDelayFrames;    // atomic
+    unsigned long long dropped; // events lost because the reader fell behind
+} EventStream;
+
+EventStream* createEventStream(size_t capacity, double sampleRate);
+void destroyEventStream(EventStream* stream);
+
+// deviceLatency is the device buffer in seconds (period size times period count): positive
+// for playback, where a block is heard after it was handed to the tracker, and negative for
+// capture, where it was recorded before it arrived (getDeviceLatency() gives both). Can be
+// called while the producer runs, e.g. after reopening the device.
+void setEventStreamLatency(EventStream* stream, double deviceLatency, int analysisDelayFrames);
+
+// A TrackerEventCallback; userData is the EventStream
+void eventStreamCallback(const TrackerEvent* event, void* userData);
+// Returns the number of events copied into events
+size_t readEventStream(EventStream* stream, StreamEvent* events, size_t maxEvents);
+
+#endif // EVENT_STREAM_H
@@ -0,0 +1,445 @@
+#include "headless.h"
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "analysis.h"
+#include "audio_decode.h"
+#include "capture.h"
+#include "event_format.h"
+#include "osc_output.h"
+#include "parameters.h"
+#include "timing.h"
+#include "tracker.h"
+#ifdef __linux__
+#include "shm_ring.h"
+#endif
+
+#define SHM_RING_FRAMES (1 << 17)
+#define SHM_CHUNK_FRAMES 4096
+#define PIPE_BLOCK_BYTES (1 << 20)
+#define PIPE_CONVERT_FRAMES 16384
+#define PIPE_DEFAULT_OUTPUT_BUFFER 65536
+
+static void print_usage(const char* program) {
+    printf("Usage: %s --headless [--beats] [-i parameter=value ...] <audio file>...\n", program);
+    printf("       %s --headless --capture [--period frames] [--seconds n] [--osc host:port] [-i parameter=value ...]\n", program);
+    printf("Prints the final tempo of each file, and its beat times in seconds with --beats. Parameter\n");
+    printf("sets separated by --vs (-i a=1 --vs -i a=2) are compared, printing one tempo per set.\n");
+    printf("--capture tracks the default input device instead and prints each beat with its tempo and\n");
+    printf("the latency from the samples arriving to the beat being reported. --osc also sends /tempo,\n");
+    printf("/beat and /onset messages over UDP.\n");
+    printf("       %s --pipe [--rate hz] [--channels n] [--format f32|s16] [--onsets]\n", program);
+    printf("              [--output-buffer line|bytes] [-i parameter=value ...]\n");
+    printf("--pipe reads raw interleaved PCM from stdin and prints a JSON line per tempo change and beat\n");
+    printf("(and onset with --onsets). Output is block buffered (%d bytes) unless set otherwise.\n", PIPE_DEFAULT_OUTPUT_BUFFER);
+#ifdef __linux__
+    printf("       %s --headless --shm name [--shm-format f32|s16] [-i parameter=value ...]\n", program);
+    printf("--shm creates a shared memory ring (see shm_ring.h) for another process to write mono audio\n");
+    printf("at %d Hz into, and prints a JSON line per event until the producer finishes.\n", ANALYSIS_SAMPLE_RATE);
+#endif
+}
+
+bool wants_headless(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0 || strcmp(argv[i], "--pipe") == 0) return true;
+    }
+    return false;
+}
+
+static int analyze_file(const char* path, const ParameterSet* parameterSets, int numSets, bool printBeats) {
+    DecodedAudio audio;
+    if (decodeAudioFile(path, ANALYSIS_SAMPLE_RATE, NULL, &audio) != 0) {
+        printf("Could not load file: %s\n", path);
+        return -1;
+    }
+
+    AnalysisResult results[MAX_TRACKER_FOLLOWERS + 1];
+    int status = analyzeBufferSets(audio.samples, audio.frameCount, parameterSets, numSets, results);
+    freeDecodedAudio(&audio);
+    if (status != 0) {
+        printf("Could not analyze file: %s\n", path);
+        return -1;
+    }
+
+    printf("%s", path);
+    for (int set = 0; set < numSets; set++) {
+        printf("\t%.2f", results[set].tempo);
+    }
+    printf("\n");
+    for (int set = 0; set < numSets; set++) {
+        for (int i = 0; printBeats && i < results[set].numBeats; i++) {
+            // With several sets each beat is prefixed with the number of its set
+            if (numSets > 1) printf("%d\t", set + 1);
+            printf("%.4f\n", results[set].beats[i]);
+        }
+        freeAnalysisResult(&results[set]);
+    }
+    return 0;
+}
+
+/**
+ * Live input
+ */
+static volatile sig_atomic_t captureInterrupted = 0;
+
+static void on_interrupt(int signal) {
+    (void)signal;
+    captureInterrupted = 1;
+}
+
+typedef struct {
+    LatencyStats latency;
+    OscOutput* osc;
+} CaptureSession;
+
+static void on_capture_event(const TrackerEvent* event, void* userData) {
+    CaptureSession* session = (CaptureSession*)userData;
+    if (session->osc) {
+        oscOutputCallback(event, session->osc);
+    }
+    if (event->type != TRACKER_EVENT_BEAT) return;
+
+    addLatencySample(&session->latency, event->latency);
+    printf("%.4f\t%.2f\t%.1f ms\n", event->time, event->tempo, event->latency * 1e3);
+    fflush(stdout);
+}
+
+static int run_capture(const ParameterSet* parameters, unsigned periodFrames, double seconds, const char* oscAddress) {
+    CaptureSession session = {{0, 0, 0}, NULL};
+    Tracker* tracker = createTracker(BTT_ONSET_AND_TEMPO_AND_BEAT_TRACKING, parameters);
+    if (!tracker) {
+        printf("Could not create the tracker\n");
+        return 1;
+    }
+    setTrackerEventCallback(tracker, on_capture_event, &session);
+
+    if (oscAddress) {
+        session.osc = createOscOutput(oscAddress, tracker->sampleRate);
+        if (!session.osc || startOscOutput(session.osc) != 0) {
+            if (session.osc) destroyOscOutput(session.osc);
+            destroyTracker(tracker);
+            return 1;
+        }
+    }
+
+    // No waveform buffer: without the GUI the audio callback only feeds the tracker
+    Capture* capture = startTracker(tracker) == 0 ? createCapture(tracker, NULL, periodFrames) : NULL;
+    if (capture && session.osc) {
+        setOscOutputLatency(session.osc, getDeviceLatency(&capture->device));
+    }
+    if (!capture || startCapture(capture) != 0) {
+        if (capture) destroyCapture(capture);
+        destroyTracker(tracker);
+        if (session.osc) destroyOscOutput(session.osc);
+        return 1;
+    }
+    printf("Capturing at %.0f Hz, %u frames x %u periods\n", tracker->sampleRate, capture->periodFrames, capture->periods);
+
+    signal(SIGINT, on_interrupt);
+    double start = getMonotonicTime();
+    while (!captureInterrupted && (seconds <= 0 || getMonotonicTime() - start < seconds)) {
+        sleepSeconds(0.05);
+    }
+    signal(SIGINT, SIG_DFL);
+
+    double bufferSeconds = (double)capture->periodFrames * capture->periods / tracker->sampleRate;
+    stopCapture(capture);
+    destroyCapture(capture);
+    stopTracker(tracker);
+    unsigned long long droppedFrames = tracker->droppedFrames;
+    destroyTracker(tracker);
+    if (session.osc) destroyOscOutput(session.osc);
+
+    // The device buffer comes on top of the measured latency, which starts at arrival
+    printf("%llu beats, latency mean %.1f ms, max %.1f ms, device buffer %.1f ms\n",
+           session.latency.count, session.latency.mean * 1e3, session.latency.max * 1e3, bufferSeconds * 1e3);
+    if (droppedFrames > 0) {
+        printf("%llu frames dropped because the analysis fell behind\n", droppedFrames);
+    }
+    return 0;
+}
+
+#ifdef __linux__
+/**
+ * Shared memory input
+ */
+static void on_shm_event(const TrackerEvent* event, void* userData) {
+    (void)userData;
+    char line[160];
+    if (formatEventJson(line, sizeof(line), event->type, event->sampleIndex, event->time, event->tempo) > 0) {
+        fputs(line, stdout);
+    }
+}
+
+static int run_shm(const ParameterSet* parameters, const char* name, ShmSampleFormat format) {
+    Tracker* tracker = createTracker(BTT_ONSET_AND_TEMPO_AND_BEAT_TRACKING, parameters);
+    if (!tracker) {
+        printf("Could not create the tracker\n");
+        return 1;
+    }
+    setTrackerEventCallback(tracker, on_shm_event, NULL);
+
+    ShmRing* ring = createShmRing(name, SHM_RING_FRAMES, (unsigned)tracker->sampleRate, format);
+    if (!ring) {
+        destroyTracker(tracker);
+        return 1;
+    }
+    fprintf(stderr, "Waiting for audio on %s\n", name);
+
+    // BTT may use its input as scratch, so even floats are copied out of the mapping (by
+    // processTrackerAudio) rather than handed to it where they lie
+    float converted[SHM_CHUNK_FRAMES];
+
+    signal(SIGINT, on_interrupt);
+    while (!captureInterrupted && !isShmRingFinished(ring)) {
+        if (!waitShmRingReadable(ring, 100)) continue;
+
+        size_t count;
+        const void* frames = peekShmRing(ring, &count);
+        if (count > SHM_CHUNK_FRAMES) count = SHM_CHUNK_FRAMES;
+        if (count == 0) continue;
+
+        if (format == SHM_FORMAT_F32) {
+            processTrackerAudio(tracker, (const float*)frames, count);
+        } else {
+            const int16_t* samples = (const int16_t*)frames;
+            for (size_t i = 0; i < count; i++) {
+                converted[i] = samples[i] / 32768.0f;
+            }
+            processTrackerAudio(tracker, converted, count);
+        }
+        consumeShmRing(ring, count);
+    }
+    signal(SIGINT, SIG_DFL);
+
+    fflush(stdout);
+    bool broken = ring->broken;
+    if (broken) {
+        fprintf(stderr, "The producer corrupted %s\n", name);
+    }
+    closeShmRing(ring);
+    destroyTracker(tracker);
+    return broken ? 1 : 0;
+}
+#endif
+
+/**
+ * stdin to stdout
+ */
+typedef struct {
+    unsigned inputRate;
+    unsigned channels;
+    ma_format format;
+    bool printOnsets;
+    const char* outputBuffer;   // "line", or a size in bytes
+} PipeOptions;
+
+typedef struct {
+    double rateRatio;           // input frames per analyzed frame
+    bool printOnsets;
+} PipeState;
+
+static void on_pipe_event(const TrackerEvent* event, void* userData) {
+    PipeState* state = (PipeState*)userData;
+    if (event->type == TRACKER_EVENT_ONSET && !state->printOnsets) return;
+
+    char line[160];
+    unsigned long long sampleIndex = (unsigned long long)((double)event->sampleIndex * state->rateRatio + 0.5);
+    int length = formatEventJson(line, sizeof(line), event->type, sampleIndex, event->time, event->tempo);
+    if (length > 0) {
+        fwrite(line, 1, (size_t)length, stdout);
+    }
+}
+
+static void track_converted(Tracker* tracker, float* converted, size_t count) {
+    if (sizeof(dft_sample_t) == sizeof(float)) {
+        processTrackerSamples(tracker, (dft_sample_t*)converted, count);
+    } else {
+        processTrackerAudio(tracker, converted, count);
+    }
+}
+
+static int run_pipe(const ParameterSet* parameters, const PipeOptions* options) {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+    static char outputBuffer[PIPE_DEFAULT_OUTPUT_BUFFER];
+    if (!options->outputBuffer) {
+        setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+    } else if (strcmp(options->outputBuffer, "line") == 0) {
+        setvbuf(stdout, NULL, _IOLBF, 0);
+    } else {
+        size_t size = (size_t)atol(options->outputBuffer);
+        setvbuf(stdout, NULL, size > 0 ? _IOFBF : _IONBF, size);
+    }
+
+    Tracker* tracker = createTracker(BTT_ONSET_AND_TEMPO_AND_BEAT_TRACKING, parameters);
+    if (!tracker) {
+        fprintf(stderr, "Could not create the tracker\n");
+        return 1;
+    }
+    PipeState state = {(double)options->inputRate / tracker->sampleRate, options->printOnsets};
+    setTrackerEventCallback(tracker, on_pipe_event, &state);
+
+    // Sample format, downmix and resampling to BTT's rate in one pass
+    ma_data_converter converter;
+    ma_data_converter_config config = ma_data_converter_config_init(options->format, ma_format_f32, options->channels, 1,
+                                                                    options->inputRate, (ma_uint32)tracker->sampleRate);
+    if (ma_data_converter_init(&config, NULL, &converter) != MA_SUCCESS) {
+        fprintf(stderr, "Unsupported input format\n");
+        destroyTracker(tracker);
+        return 1;
+    }
+
+    size_t frameSize = ma_get_bytes_per_frame(options->format, options->channels);
+    unsigned char* input = (unsigned char*)malloc(PIPE_BLOCK_BYTES);
+    float* converted = (float*)malloc(PIPE_CONVERT_FRAMES * sizeof(float));
+    size_t fill = 0;
+
+    for (;;) {
+        size_t count = fread(input + fill, 1, PIPE_BLOCK_BYTES - fill, stdin);
+        if (count == 0) break;
+        fill += count;
+
+        // A block can end in the middle of a frame; the rest stays for the next read
+        size_t offset = 0;
+        while (fill - offset >= frameSize) {
+            ma_uint64 frameIn = (fill - offset) / frameSize;
+            ma_uint64 frameOut = PIPE_CONVERT_FRAMES;
+            ma_data_converter_process_pcm_frames(&converter, input + offset, &frameIn, converted, &frameOut);
+            if (frameIn == 0 && frameOut == 0) break;
+            offset += (size_t)frameIn * frameSize;
+            track_converted(tracker, converted, (size_t)frameOut);
+        }
+        memmove(input, input + offset, fill - offset);
+        fill -= offset;
+    }
+
+    // The resampler holds back its last few frames; push them out with silence (a NULL input
+    // reads as zeros)
+    ma_uint64 flushFrames = ma_data_converter_get_input_latency(&converter);
+    while (flushFrames > 0) {
+        ma_uint64 frameIn = flushFrames;
+        ma_uint64 frameOut = PIPE_CONVERT_FRAMES;
+        ma_data_converter_process_pcm_frames(&converter, NULL, &frameIn, converted, &frameOut);
+        if (frameIn == 0 && frameOut == 0) break;
+        flushFrames -= frameIn;
+        track_converted(tracker, converted, (size_t)frameOut);
+    }
+
+    fflush(stdout);
+    free(input);
+    free(converted);
+    ma_data_converter_uninit(&converter, NULL);
+    destroyTracker(tracker);
+    return ferror(stdin) ? 1 : 0;
+}
+
+int run_headless(int argc, char* argv[]) {
+    ParameterSet parameterSets[MAX_TRACKER_FOLLOWERS + 1];
+    const ParameterSet* parameters = &parameterSets[0];
+    bool printBeats = false;
+    bool live = false;
+    unsigned periodFrames = 0;
+    double seconds = 0;
+    const char* oscAddress = NULL;
+    const char* shmName = NULL;
+    bool shmS16 = false;
+    bool pipe = false;
+    PipeOptions pipeOptions = {ANALYSIS_SAMPLE_RATE, 2, ma_format_f32, false, NULL};
+    int numFiles = 0;
+    int failures = 0;
+
+    int numSets = collect_parameter_sets(parameterSets, MAX_TRACKER_FOLLOWERS + 1, argc, argv);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            i++;  // already handled by collect_parameter_sets
+        } else if (strcmp(argv[i], PARAMETER_SET_SEPARATOR) == 0 || strcmp(argv[i], "--headless") == 0) {
+            continue;
+        } else if (strcmp(argv[i], "--beats") == 0) {
+            printBeats = true;
+        } else if (strcmp(argv[i], "--capture") == 0) {
+            live = true;
+        } else if (strcmp(argv[i], "--period") == 0 && i + 1 < argc) {
+            periodFrames = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--osc") == 0 && i + 1 < argc) {
+            oscAddress = argv[++i];
+        } else if (strcmp(argv[i], "--shm") == 0 && i + 1 < argc) {
+            shmName = argv[++i];
+        } else if (strcmp(argv[i], "--shm-format") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "f32") != 0 && strcmp(argv[i], "s16") != 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            shmS16 = strcmp(argv[i], "s16") == 0;
+        } else if (strcmp(argv[i], "--pipe") == 0) {
+            pipe = true;
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            pipeOptions.inputRate = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--channels") == 0 && i + 1 < argc) {
+            pipeOptions.channels = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "f32") == 0) {
+                pipeOptions.format = ma_format_f32;
+            } else if (strcmp(argv[i], "s16") == 0) {
+                pipeOptions.format = ma_format_s16;
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--onsets") == 0) {
+            pipeOptions.printOnsets = true;
+        } else if (strcmp(argv[i], "--output-buffer") == 0 && i + 1 < argc) {
+            pipeOptions.outputBuffer = argv[++i];
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            // Files are moved to the front of argv, as getopt does, and analyzed once all
+            // options are known
+            argv[1 + numFiles++] = argv[i];
+        }
+    }
+
+    if (pipe) {
+        return run_pipe(parameters, &pipeOptions);
+    }
+    if (live) {
+        return run_capture(parameters, periodFrames, seconds, oscAddress);
+    }
+    if (shmName) {
+#ifdef __linux__
+        return run_shm(parameters, shmName, shmS16 ? SHM_FORMAT_S16 : SHM_FORMAT_F32);
+#else
+        (void)shmS16;
+        printf("--shm is only available on Linux\n");
+        return 1;
+#endif
+    }
+    if (numFiles == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    for (int i = 0; i < numFiles; i++) {
+        if (analyze_file(argv[1 + i], parameterSets, numSets, printBeats) != 0) failures++;
+    }
+    return failures ? 1 : 0;
+}
+
+#ifndef TEMPOTEST_GUI
+int main(int argc, char* argv[]) {
+    return run_headless(argc, argv);
+}
+#endif
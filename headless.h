@@ -0,0 +1,10 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <stdbool.h>
+
+// Command line front end for running the analysis without the GUI
+bool wants_headless(int argc, char* argv[]);
+int run_headless(int argc, char* argv[]);
+
+#endif // HEADLESS_H
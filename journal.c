@@ -0,0 +1,161 @@
+#include "journal.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <io.h>
+#define fsync _commit
+#else
+#include <unistd.h>
+#endif
+
+static void add_entry(Journal* journal, const char* line) {
+    const char* tab = strchr(line, '\t');
+    if (!tab || tab == line) return;
+
+    if (journal->count == journal->capacity) {
+        journal->capacity = journal->capacity ? journal->capacity * 2 : 256;
+        journal->entries = (JournalEntry*)realloc(journal->entries, journal->capacity * sizeof(JournalEntry));
+    }
+
+    JournalEntry* entry = &journal->entries[journal->count++];
+    entry->line = strdup(line);
+    size_t keyLength = (size_t)(tab - line);
+    entry->key = (char*)malloc(keyLength + 1);
+    memcpy(entry->key, line, keyLength);
+    entry->key[keyLength] = '\0';
+}
+
+// Returns 1 if the file ends in the middle of a line, i.e. the last append was cut short
+static int load_entries(Journal* journal, FILE* file) {
+    size_t capacity = 4096;
+    char* line = (char*)malloc(capacity);
+    int partial = 0;
+
+    for (;;) {
+        size_t length = 0;
+        int c;
+        while ((c = fgetc(file)) != EOF && c != '\n') {
+            if (length + 1 == capacity) {
+                capacity *= 2;
+                line = (char*)realloc(line, capacity);
+            }
+            line[length++] = (char)c;
+        }
+        line[length] = '\0';
+
+        if (c == EOF) {
+            // A line without its newline was never completely written, so it is not trusted
+            partial = length > 0;
+            break;
+        }
+        add_entry(journal, line);
+    }
+
+    free(line);
+    return partial;
+}
+
+static int compare_entries(const void* a, const void* b) {
+    const JournalEntry* x = (const JournalEntry*)a;
+    const JournalEntry* y = (const JournalEntry*)b;
+    int order = strcmp(x->key, y->key);
+    return order ? order : strcmp(x->line, y->line);
+}
+
+// Sorted entries give lookups in O(log n) and a merge order that does not depend on
+// which worker finished first
+static void sort_entries(Journal* journal) {
+    qsort(journal->entries, journal->count, sizeof(JournalEntry), compare_entries);
+}
+
+static Journal* create_journal(int syncInterval) {
+    Journal* journal = (Journal*)calloc(1, sizeof(Journal));
+    journal->syncInterval = syncInterval > 0 ? syncInterval : 1;
+    pthread_mutex_init(&journal->mutex, NULL);
+    return journal;
+}
+
+Journal* openJournal(const char* path, int syncInterval) {
+    Journal* journal = create_journal(syncInterval);
+    int partial = 0;
+
+    FILE* existing = fopen(path, "r");
+    if (existing) {
+        partial = load_entries(journal, existing);
+        fclose(existing);
+        sort_entries(journal);
+    }
+
+    journal->file = fopen(path, "a");
+    if (!journal->file) {
+        closeJournal(journal);
+        return NULL;
+    }
+
+    // Terminate a torn final line so the next append starts on a line of its own
+    if (partial) {
+        fputc('\n', journal->file);
+        fflush(journal->file);
+    }
+    return journal;
+}
+
+Journal* readJournal(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return NULL;
+    }
+
+    Journal* journal = create_journal(1);
+    load_entries(journal, file);
+    fclose(file);
+    sort_entries(journal);
+    return journal;
+}
+
+const JournalEntry* findJournalEntry(const Journal* journal, const char* key) {
+    int lo = 0, hi = journal->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcmp(journal->entries[mid].key, key) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < journal->count && strcmp(journal->entries[lo].key, key) == 0) {
+        return &journal->entries[lo];
+    }
+    return NULL;
+}
+
+static void sync_journal(Journal* journal) {
+    fflush(journal->file);
+    fsync(fileno(journal->file));
+    journal->unsynced = 0;
+}
+
+int appendToJournal(Journal* journal, const char* line) {
+    pthread_mutex_lock(&journal->mutex);
+
+    int ok = fprintf(journal->file, "%s\n", line) > 0;
+    // Flushing every entry keeps lines whole; fsync is batched to bound the cost
+    fflush(journal->file);
+    if (++journal->unsynced >= journal->syncInterval) {
+        sync_journal(journal);
+    }
+
+    pthread_mutex_unlock(&journal->mutex);
+    return ok ? 0 : -1;
+}
+
+void closeJournal(Journal* journal) {
+    if (journal->file) {
+        sync_journal(journal);
+        fclose(journal->file);
+    }
+    for (int i = 0; i < journal->count; i++) {
+        free(journal->entries[i].key);
+        free(journal->entries[i].line);
+    }
+    free(journal->entries);
+    pthread_mutex_destroy(&journal->mutex);
+    free(journal);
+}
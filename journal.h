@@ -0,0 +1,33 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+// An append-only log of completed results, one tab separated line per entry whose first
+// field is the key. Reopening an existing journal loads its entries so finished work can
+// be skipped after a crash.
+typedef struct {
+    char* key;
+    char* line;     // whole line without the trailing newline
+} JournalEntry;
+
+typedef struct {
+    FILE* file;
+    JournalEntry* entries;
+    int count;
+    int capacity;
+    int syncInterval;   // fsync after this many appends
+    int unsynced;
+    pthread_mutex_t mutex;
+} Journal;
+
+Journal* openJournal(const char* path, int syncInterval);
+// Loads entries without opening the journal for writing
+Journal* readJournal(const char* path);
+// Only finds entries that were loaded when the journal was opened, not later appends
+const JournalEntry* findJournalEntry(const Journal* journal, const char* key);
+int appendToJournal(Journal* journal, const char* line);
+void closeJournal(Journal* journal);
+
+#endif // JOURNAL_H
@@ -0,0 +1,552 @@
+#include "lookahead.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "event_stream.h"
+#include "timing.h"
+
+#include "lib/miniaudio.h"
+
+#define LOOKAHEAD_CHUNK_FRAMES 4096
+#define LOOKAHEAD_POLL_SECONDS 0.005
+// The cursor is reported once per device period, so its offset from the clock jitters a little
+#define LOOKAHEAD_SEEK_TOLERANCE 0.1
+
+typedef struct {
+    TrackerEventType type;
+    unsigned long long sampleIndex;     // in the file, as BTT reported it
+    double tempo;
+    float level;
+} TimelineEvent;
+
+typedef struct {
+    unsigned long long start;
+    unsigned long long end;             // everything in [start, end) is on the timeline
+} TimelineRange;
+
+typedef struct {
+    TimelineEvent* events;
+    size_t count;
+    size_t capacity;
+} EventList;
+
+struct Lookahead {
+    ma_decoder decoder;
+    ParameterSet parameters;
+    bool hasParameters;
+    double sampleRate;
+    unsigned long long length;          // frames, ULLONG_MAX until the end has been seen
+    unsigned long long aheadFrames;
+    unsigned long long warmupFrames;
+
+    // The analysis job; only the lookahead thread touches these
+    Tracker* tracker;                   // NULL when no job is running
+    unsigned long long jobStart;        // where the tracker started decoding
+    unsigned long long jobKeep;         // where its results start being kept
+    unsigned long long jobPosition;
+    unsigned long long jobRange;        // start of the range being extended
+    bool jobSettled;
+    EventList pending;                  // results not yet on the timeline
+
+    // The timeline; the thread writes it and readers take the mutex
+    pthread_mutex_t mutex;
+    EventList timeline;
+    TimelineRange* ranges;              // sorted, disjoint
+    size_t numRanges;
+    size_t rangeCapacity;
+
+    // Playback cursor: getMonotonicTime() at which the file's first frame would have been played
+    double clockOffset;
+    int cursorValid;
+    double lastOffset;
+    unsigned long long dispatchFrom;
+    bool announceTempo;                 // a seek has not been followed by a tempo yet
+
+    TrackerEventCallback callback;
+    void* userData;
+    pthread_t thread;
+    bool threadRunning;
+    int stopRequested;
+    int finished;
+};
+
+/**
+ * Timeline
+ */
+static void append_event(EventList* list, const TimelineEvent* event) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 256;
+        list->events = (TimelineEvent*)realloc(list->events, list->capacity * sizeof(TimelineEvent));
+    }
+    list->events[list->count++] = *event;
+}
+
+// Index of the first event at or after sampleIndex
+static size_t lower_bound(const EventList* list, unsigned long long sampleIndex) {
+    size_t low = 0, high = list->count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (list->events[mid].sampleIndex < sampleIndex) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+static int compare_events(const void* a, const void* b) {
+    unsigned long long x = ((const TimelineEvent*)a)->sampleIndex;
+    unsigned long long y = ((const TimelineEvent*)b)->sampleIndex;
+    return x < y ? -1 : x > y;
+}
+
+// The range containing frame, counting its end so that a range being extended contains the
+// frame it has reached
+static TimelineRange* find_range(Lookahead* lookahead, unsigned long long frame) {
+    for (size_t i = 0; i < lookahead->numRanges; i++) {
+        TimelineRange* range = &lookahead->ranges[i];
+        if (range->start <= frame && frame <= range->end) return range;
+        if (range->start > frame) break;
+    }
+    return NULL;
+}
+
+static TimelineRange* find_range_start(Lookahead* lookahead, unsigned long long start) {
+    for (size_t i = 0; i < lookahead->numRanges; i++) {
+        if (lookahead->ranges[i].start == start) return &lookahead->ranges[i];
+    }
+    return NULL;
+}
+
+static void insert_range(Lookahead* lookahead, unsigned long long start) {
+    if (lookahead->numRanges == lookahead->rangeCapacity) {
+        lookahead->rangeCapacity = lookahead->rangeCapacity ? lookahead->rangeCapacity * 2 : 16;
+        lookahead->ranges = (TimelineRange*)realloc(lookahead->ranges, lookahead->rangeCapacity * sizeof(TimelineRange));
+    }
+    size_t i = 0;
+    while (i < lookahead->numRanges && lookahead->ranges[i].start < start) i++;
+    memmove(&lookahead->ranges[i + 1], &lookahead->ranges[i], (lookahead->numRanges - i) * sizeof(TimelineRange));
+    lookahead->ranges[i].start = start;
+    lookahead->ranges[i].end = start;
+    lookahead->numRanges++;
+}
+
+static void remove_range(Lookahead* lookahead, TimelineRange* range) {
+    size_t i = (size_t)(range - lookahead->ranges);
+    memmove(&lookahead->ranges[i], &lookahead->ranges[i + 1], (lookahead->numRanges - i - 1) * sizeof(TimelineRange));
+    lookahead->numRanges--;
+}
+
+/**
+ * Analysis job
+ */
+static void on_job_event(const TrackerEvent* event, void* userData) {
+    Lookahead* lookahead = (Lookahead*)userData;
+    TimelineEvent timelineEvent;
+    timelineEvent.type = event->type;
+    timelineEvent.sampleIndex = lookahead->jobStart + event->sampleIndex;
+    timelineEvent.tempo = event->tempo;
+    timelineEvent.level = event->level;
+    if (timelineEvent.sampleIndex >= lookahead->jobKeep) {
+        append_event(&lookahead->pending, &timelineEvent);
+    }
+}
+
+static void end_job(Lookahead* lookahead) {
+    if (!lookahead->tracker) return;
+    destroyTracker(lookahead->tracker);
+    lookahead->tracker = NULL;
+    lookahead->pending.count = 0;
+
+    // A range that never got any results is dropped rather than left empty
+    TimelineRange* range = find_range_start(lookahead, lookahead->jobRange);
+    if (range && range->end == range->start) {
+        remove_range(lookahead, range);
+    }
+}
+
+static bool start_job(Lookahead* lookahead, unsigned long long keep, unsigned long long rangeStart) {
+    end_job(lookahead);
+    unsigned long long start = keep > lookahead->warmupFrames ? keep - lookahead->warmupFrames : 0;
+    if (ma_decoder_seek_to_pcm_frame(&lookahead->decoder, start) != MA_SUCCESS) {
+        return false;
+    }
+
+    lookahead->tracker = createTracker(BTT_ONSET_AND_TEMPO_AND_BEAT_TRACKING,
+                                       lookahead->hasParameters ? &lookahead->parameters : NULL);
+    if (!lookahead->tracker) {
+        return false;
+    }
+    setTrackerEventCallback(lookahead->tracker, on_job_event, lookahead);
+    lookahead->jobStart = start;
+    lookahead->jobKeep = keep;
+    lookahead->jobPosition = start;
+    lookahead->jobRange = rangeStart;
+    lookahead->jobSettled = false;
+    return true;
+}
+
+// BTT needs a few seconds of audio before its tempo and beats settle. A job that could not
+// warm up before jobKeep (the start of the file) replaces what it found before that point with
+// the settled tempo, and beats extrapolated back from the last early one at that tempo.
+static void settle_job(Lookahead* lookahead) {
+    EventList* pending = &lookahead->pending;
+    unsigned long long settlePoint = lookahead->jobStart + lookahead->warmupFrames;
+    double tempo = lookahead->tracker->tempo;
+    lookahead->jobSettled = true;
+    if (tempo <= 0) {
+        return;
+    }
+    // The range starts with the tempo, so that a seek into it knows the tempo from the start
+    TimelineEvent settled = {TRACKER_EVENT_TEMPO, lookahead->jobKeep, tempo, 0};
+    if (settlePoint <= lookahead->jobKeep) {
+        append_event(pending, &settled);
+        return;
+    }
+
+    qsort(pending->events, pending->count, sizeof(TimelineEvent), compare_events);
+    bool haveBeat = false;
+    TimelineEvent lastBeat;
+    for (size_t i = 0; i < pending->count && pending->events[i].sampleIndex < settlePoint; i++) {
+        if (pending->events[i].type == TRACKER_EVENT_BEAT) {
+            lastBeat = pending->events[i];
+            haveBeat = true;
+        }
+    }
+
+    // Onsets stay; early tempo changes and the beats before the last early one go
+    size_t kept = 0;
+    for (size_t i = 0; i < pending->count; i++) {
+        TimelineEvent* event = &pending->events[i];
+        if (event->sampleIndex < settlePoint && event->type == TRACKER_EVENT_TEMPO) continue;
+        if (haveBeat && event->type == TRACKER_EVENT_BEAT && event->sampleIndex < lastBeat.sampleIndex) continue;
+        pending->events[kept++] = *event;
+    }
+    pending->count = kept;
+
+    append_event(pending, &settled);
+    if (haveBeat) {
+        double period = 60.0 * lookahead->sampleRate / tempo;
+        for (double beat = (double)lastBeat.sampleIndex - period; beat >= (double)lookahead->jobKeep; beat -= period) {
+            TimelineEvent extrapolated = lastBeat;
+            extrapolated.sampleIndex = (unsigned long long)beat;
+            append_event(pending, &extrapolated);
+        }
+    }
+}
+
+// Moves the job's results onto the timeline and extends its range to where it has got. A job
+// that has to stop (end of file, or the next range) settles with what it has.
+static void publish_job(Lookahead* lookahead, TimelineRange* range, bool stopping) {
+    if (!lookahead->jobSettled) {
+        if (lookahead->jobPosition < lookahead->jobStart + lookahead->warmupFrames && !stopping) {
+            return;
+        }
+        settle_job(lookahead);
+    }
+    if (lookahead->jobPosition <= range->end) {
+        return;
+    }
+
+    EventList* pending = &lookahead->pending;
+    EventList* timeline = &lookahead->timeline;
+    qsort(pending->events, pending->count, sizeof(TimelineEvent), compare_events);
+    if (pending->count > 0) {
+        size_t at = lower_bound(timeline, pending->events[0].sampleIndex);
+        if (timeline->count + pending->count > timeline->capacity) {
+            while (timeline->count + pending->count > timeline->capacity) {
+                timeline->capacity = timeline->capacity ? timeline->capacity * 2 : 1024;
+            }
+            timeline->events = (TimelineEvent*)realloc(timeline->events, timeline->capacity * sizeof(TimelineEvent));
+        }
+        memmove(&timeline->events[at + pending->count], &timeline->events[at], (timeline->count - at) * sizeof(TimelineEvent));
+        memcpy(&timeline->events[at], pending->events, pending->count * sizeof(TimelineEvent));
+        timeline->count += pending->count;
+        pending->count = 0;
+    }
+    range->end = lookahead->jobPosition;
+}
+
+/**
+ * Dispatch
+ */
+static void emit(Lookahead* lookahead, const TimelineEvent* timelineEvent, unsigned long long sampleIndex) {
+    TrackerEvent event;
+    event.type = timelineEvent->type;
+    event.sampleIndex = sampleIndex;
+    event.time = (double)sampleIndex / lookahead->sampleRate;
+    event.tempo = timelineEvent->tempo;
+    event.latency = 0;
+    event.arrivalTime = lookahead->lastOffset + event.time;
+    event.level = timelineEvent->level;
+    lookahead->callback(&event, lookahead->userData);
+}
+
+// Hands the events of the next LOOKAHEAD_DISPATCH_SECONDS to the callback. After a seek the
+// tempo at the new position is sent first, once it is known.
+static void dispatch(Lookahead* lookahead, unsigned long long cursor, bool seeked) {
+    if (seeked || lookahead->dispatchFrom < cursor) {
+        lookahead->dispatchFrom = cursor;
+    }
+    if (seeked) {
+        lookahead->announceTempo = true;
+    }
+    TimelineRange* range = find_range(lookahead, lookahead->dispatchFrom);
+    if (!lookahead->callback || !range || range->end == range->start) {
+        return;
+    }
+
+    EventList* timeline = &lookahead->timeline;
+    size_t first = lower_bound(timeline, lookahead->dispatchFrom);
+    if (lookahead->announceTempo) {
+        for (size_t i = first; i-- > 0 && timeline->events[i].sampleIndex >= range->start;) {
+            if (timeline->events[i].type == TRACKER_EVENT_TEMPO) {
+                emit(lookahead, &timeline->events[i], lookahead->dispatchFrom);
+                break;
+            }
+        }
+        lookahead->announceTempo = false;
+    }
+
+    unsigned long long limit = cursor + (unsigned long long)(LOOKAHEAD_DISPATCH_SECONDS * lookahead->sampleRate);
+    if (limit > range->end) limit = range->end;
+    for (size_t i = first; i < timeline->count && timeline->events[i].sampleIndex < limit; i++) {
+        emit(lookahead, &timeline->events[i], timeline->events[i].sampleIndex);
+    }
+    if (limit > lookahead->dispatchFrom) {
+        lookahead->dispatchFrom = limit;
+    }
+}
+
+/**
+ * Thread
+ */
+// Returns false until the audio callback has reported a position
+static bool read_cursor(Lookahead* lookahead, unsigned long long* cursor, bool* seeked) {
+    *cursor = 0;
+    *seeked = false;
+    if (!__atomic_load_n(&lookahead->cursorValid, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    double offset;
+    __atomic_load(&lookahead->clockOffset, &offset, __ATOMIC_ACQUIRE);
+    double difference = offset - lookahead->lastOffset;
+    *seeked = difference > LOOKAHEAD_SEEK_TOLERANCE || difference < -LOOKAHEAD_SEEK_TOLERANCE;
+    lookahead->lastOffset = offset;
+
+    double seconds = getMonotonicTime() - offset;
+    *cursor = seconds > 0 ? (unsigned long long)(seconds * lookahead->sampleRate) : 0;
+    return true;
+}
+
+// The range to extend for a cursor: the one it is in, or the one being analyzed if the cursor
+// is close enough past its end that catching up costs less than warming up a new job
+static TimelineRange* range_for_cursor(Lookahead* lookahead, unsigned long long cursor) {
+    TimelineRange* range = find_range(lookahead, cursor);
+    if (!range && lookahead->tracker) {
+        TimelineRange* job = find_range_start(lookahead, lookahead->jobRange);
+        if (job && job->start <= cursor && cursor < job->end + lookahead->warmupFrames) {
+            range = job;
+        }
+    }
+    return range;
+}
+
+static void* lookahead_thread(void* arg) {
+    Lookahead* lookahead = (Lookahead*)arg;
+    float block[LOOKAHEAD_CHUNK_FRAMES];
+
+    while (!__atomic_load_n(&lookahead->stopRequested, __ATOMIC_ACQUIRE)) {
+        unsigned long long cursor;
+        bool seeked;
+        bool playing = read_cursor(lookahead, &cursor, &seeked);
+        unsigned long long want = cursor + lookahead->aheadFrames;
+        if (want > lookahead->length) want = lookahead->length;
+
+        pthread_mutex_lock(&lookahead->mutex);
+        if (playing) {
+            dispatch(lookahead, cursor, seeked);
+        }
+
+        // Pick what to analyze next: the end of the range the cursor is in, or a new range at it
+        TimelineRange* range = range_for_cursor(lookahead, cursor);
+        bool started = true;
+        if (cursor >= lookahead->length || (range && range->end >= want)) {
+            pthread_mutex_unlock(&lookahead->mutex);
+            sleepSeconds(LOOKAHEAD_POLL_SECONDS);
+            continue;
+        } else if (!range) {
+            insert_range(lookahead, cursor);
+            started = start_job(lookahead, cursor, cursor);
+        } else if (!lookahead->tracker || lookahead->jobRange != range->start) {
+            started = start_job(lookahead, range->end, range->start);
+        }
+        if (!started) {
+            end_job(lookahead);
+            pthread_mutex_unlock(&lookahead->mutex);
+            printf("Lookahead analysis failed\n");
+            break;
+        }
+
+        // Stop at the next range; what comes after it was analyzed from another start
+        unsigned long long stop = lookahead->length;
+        range = find_range_start(lookahead, lookahead->jobRange);
+        if (range + 1 < lookahead->ranges + lookahead->numRanges && range[1].start < stop) {
+            stop = range[1].start;
+        }
+        pthread_mutex_unlock(&lookahead->mutex);
+
+        ma_uint64 count = stop - lookahead->jobPosition;
+        if (count > LOOKAHEAD_CHUNK_FRAMES) count = LOOKAHEAD_CHUNK_FRAMES;
+        ma_uint64 framesRead = 0;
+        if (count > 0) {
+            ma_decoder_read_pcm_frames(&lookahead->decoder, block, count, &framesRead);
+            processTrackerAudio(lookahead->tracker, block, (size_t)framesRead);
+        }
+
+        pthread_mutex_lock(&lookahead->mutex);
+        lookahead->jobPosition += framesRead;
+        if (framesRead < count) {
+            lookahead->length = lookahead->jobPosition;
+        }
+        bool atEnd = lookahead->jobPosition >= lookahead->length;
+        bool atNext = !atEnd && lookahead->jobPosition >= stop;
+        range = find_range_start(lookahead, lookahead->jobRange);
+        publish_job(lookahead, range, atEnd || atNext);
+
+        if (atNext && range->end == stop) {
+            // Reached the next range: join them, and continue from the end of both with a new job
+            range->end = range[1].end;
+            remove_range(lookahead, &range[1]);
+        }
+        if (atEnd || atNext) {
+            end_job(lookahead);
+        }
+        pthread_mutex_unlock(&lookahead->mutex);
+    }
+
+    __atomic_store_n(&lookahead->finished, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/**
+ * API
+ */
+Lookahead* createLookahead(const char* path, const ParameterSet* parameters, double aheadSeconds) {
+    Lookahead* lookahead = (Lookahead*)calloc(1, sizeof(Lookahead));
+
+    // The tracker's rate, which only a BTT knows
+    BTT* btt = btt_new_default();
+    if (!btt) {
+        free(lookahead);
+        return NULL;
+    }
+    lookahead->sampleRate = btt_get_sample_rate(btt);
+    btt_destroy(btt);
+
+    ma_decoder_config config = ma_decoder_config_init(ma_format_f32, 1, (ma_uint32)lookahead->sampleRate);
+    if (ma_decoder_init_file(path, &config, &lookahead->decoder) != MA_SUCCESS) {
+        printf("Could not load file: %s\n", path);
+        free(lookahead);
+        return NULL;
+    }
+
+    ma_uint64 length = 0;
+    ma_decoder_get_length_in_pcm_frames(&lookahead->decoder, &length);
+    lookahead->length = length > 0 ? (unsigned long long)length : ~0ull;
+    if (parameters) {
+        lookahead->parameters = *parameters;
+        lookahead->hasParameters = true;
+    }
+    if (aheadSeconds < LOOKAHEAD_DISPATCH_SECONDS) aheadSeconds = LOOKAHEAD_DISPATCH_SECONDS;
+    lookahead->aheadFrames = (unsigned long long)(aheadSeconds * lookahead->sampleRate);
+    lookahead->warmupFrames = (unsigned long long)(LOOKAHEAD_WARMUP_SECONDS * lookahead->sampleRate);
+    pthread_mutex_init(&lookahead->mutex, NULL);
+    return lookahead;
+}
+
+void destroyLookahead(Lookahead* lookahead) {
+    stopLookahead(lookahead);
+    if (lookahead->tracker) destroyTracker(lookahead->tracker);
+    ma_decoder_uninit(&lookahead->decoder);
+    pthread_mutex_destroy(&lookahead->mutex);
+    free(lookahead->pending.events);
+    free(lookahead->timeline.events);
+    free(lookahead->ranges);
+    free(lookahead);
+}
+
+void setLookaheadEventCallback(Lookahead* lookahead, TrackerEventCallback callback, void* userData) {
+    lookahead->callback = callback;
+    lookahead->userData = userData;
+}
+
+int startLookahead(Lookahead* lookahead) {
+    if (lookahead->threadRunning) {
+        return 0;
+    }
+    lookahead->stopRequested = 0;
+    lookahead->finished = 0;
+    if (pthread_create(&lookahead->thread, NULL, lookahead_thread, lookahead) != 0) {
+        return -1;
+    }
+    lookahead->threadRunning = true;
+    return 0;
+}
+
+void stopLookahead(Lookahead* lookahead) {
+    if (!lookahead->threadRunning) {
+        return;
+    }
+    __atomic_store_n(&lookahead->stopRequested, 1, __ATOMIC_RELEASE);
+    pthread_join(lookahead->thread, NULL);
+    lookahead->threadRunning = false;
+}
+
+bool waitLookahead(Lookahead* lookahead, double seconds) {
+    unsigned long long frames = (unsigned long long)(seconds * lookahead->sampleRate);
+    for (;;) {
+        pthread_mutex_lock(&lookahead->mutex);
+        if (frames > lookahead->length) frames = lookahead->length;
+        TimelineRange* range = find_range(lookahead, 0);
+        bool ready = range && range->end >= frames && range->end > 0;
+        pthread_mutex_unlock(&lookahead->mutex);
+        if (ready) return true;
+        if (__atomic_load_n(&lookahead->finished, __ATOMIC_ACQUIRE)) return false;
+        sleepSeconds(LOOKAHEAD_POLL_SECONDS);
+    }
+}
+
+void setLookaheadCursor(Lookahead* lookahead, double seconds) {
+    double offset = getMonotonicTime() - seconds;
+    __atomic_store(&lookahead->clockOffset, &offset, __ATOMIC_RELEASE);
+    __atomic_store_n(&lookahead->cursorValid, 1, __ATOMIC_RELEASE);
+}
+
+double getLookaheadCursor(Lookahead* lookahead) {
+    if (!__atomic_load_n(&lookahead->cursorValid, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    double offset;
+    __atomic_load(&lookahead->clockOffset, &offset, __ATOMIC_ACQUIRE);
+    return getMonotonicTime() - offset;
+}
+
+size_t getLookaheadBeats(Lookahead* lookahead, double from, double to, double* times, size_t maxBeats) {
+    double delay = EVENT_STREAM_ANALYSIS_DELAY_FRAMES / lookahead->sampleRate;
+    size_t count = 0;
+
+    pthread_mutex_lock(&lookahead->mutex);
+    EventList* timeline = &lookahead->timeline;
+    double start = (from + delay) * lookahead->sampleRate;
+    for (size_t i = lower_bound(timeline, start > 0 ? (unsigned long long)start : 0);
+         i < timeline->count && count < maxBeats; i++) {
+        double time = (double)timeline->events[i].sampleIndex / lookahead->sampleRate - delay;
+        if (time >= to) break;
+        if (timeline->events[i].type == TRACKER_EVENT_BEAT) {
+            times[count++] = time;
+        }
+    }
+    pthread_mutex_unlock(&lookahead->mutex);
+    return count;
+}
@@ -0,0 +1,51 @@
+#ifndef LOOKAHEAD_H
+#define LOOKAHEAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "parameters.h"
+#include "tracker.h"
+
+#define LOOKAHEAD_DEFAULT_SECONDS 6.0
+// Analysis that starts after a seek begins this far before the seek target, so BTT has settled
+// by the time results are kept; at the start of the file the first tempo and beats are filled
+// in once it has
+#define LOOKAHEAD_WARMUP_SECONDS 4.0
+// Events are handed to the callback this long before playback reaches them
+#define LOOKAHEAD_DISPATCH_SECONDS 0.5
+
+// Analyzes a file ahead of its playback. The lookahead opens its own decoder on the file and
+// a thread keeps the analysis up to aheadSeconds in front of the playback cursor, storing
+// onsets, beats and tempo changes on a timeline indexed by their position in the file.
+//
+// The timeline is a set of analyzed ranges. A seek into a range that is already analyzed keeps
+// using it and continues the analysis from the range's end; a seek anywhere else starts a new
+// range there, and nothing else is thrown away. Events reach the callback shortly before they
+// are heard, stamped as if a live tracker had just seen them (see TrackerEvent::arrivalTime), so
+// an EventStream or OscOutput compensates them the same way as live analysis.
+typedef struct Lookahead Lookahead;
+
+// Returns NULL if the file cannot be decoded
+Lookahead* createLookahead(const char* path, const ParameterSet* parameters, double aheadSeconds);
+void destroyLookahead(Lookahead* lookahead);
+// Called on the lookahead thread; set it before startLookahead()
+void setLookaheadEventCallback(Lookahead* lookahead, TrackerEventCallback callback, void* userData);
+int startLookahead(Lookahead* lookahead);
+void stopLookahead(Lookahead* lookahead);
+
+// Blocks until the first seconds of the file (or all of it) are analyzed. Returns false if the
+// analysis stopped before that.
+bool waitLookahead(Lookahead* lookahead, double seconds);
+
+// Called from the audio callback with the position, in seconds, of the block about to be
+// played. Real time safe; a jump in position is a seek.
+void setLookaheadCursor(Lookahead* lookahead, double seconds);
+// The position being played now, in seconds
+double getLookaheadCursor(Lookahead* lookahead);
+
+// Copies the times, in seconds and compensated for the analysis delay, of the analyzed beats
+// between from and to. Returns the number copied.
+size_t getLookaheadBeats(Lookahead* lookahead, double from, double to, double* times, size_t maxBeats);
+
+#endif // LOOKAHEAD_H
@@ -6,95 +6,74 @@
 #include <string.h>
 
 #include "lib/Beat-and-Tempo-Tracking/BTT.h"
-#include "audio_queue.h"
+#include "analysis_node.h"
+#include "capture.h"
 #include "circular_buffer.h"
+#include "event_stream.h"
+#include "headless.h"
+#include "lookahead.h"
+#include "osc_output.h"
+#include "parameters.h"
+#include "timing.h"
+#include "tracker.h"
+#include "waveform.h"
 
-#define MINIAUDIO_IMPLEMENTATION
 #include "lib/miniaudio.h"
 
 #define CIRCULAR_BUFFER_SIZE (44100 * 4)
-
-typedef struct _Parameter{
-    const char* name;
-    union _setter{
-        void (*double_setter)(BTT*, double);
-        void (*int_setter)(BTT*, int);
-    } setter;
-    int is_int;
-} Parameter;
+#define EVENT_STREAM_CAPACITY 256
+#define MAX_PENDING_BEATS 16
+#define BEAT_FLASH_SECONDS 0.1
+#define SEEK_STEP_SECONDS 10.0
+#define MAX_DRAWN_BEATS 64
+
+// One tempo readout: the tempo changes and beats of an EventStream, each beat flashed as it
+// is heard
+typedef struct {
+    EventStream* events;
+    double pendingBeats[MAX_PENDING_BEATS];     // stream times of beats not yet shown
+    int numPendingBeats;
+    double lastBeatTime;
+    float currentTempo;
+    GtkWidget* tempo_label;
+} TempoView;
 
 typedef struct {
     ma_decoder decoder;
     ma_device device;
+    // Playback runs decoder -> analysis tap -> endpoint, so the tracker hears what is played
+    ma_node_graph nodeGraph;
+    ma_data_source_node sourceNode;
+    AnalysisNode analysisNode;
+    ma_uint64 playbackLength;
+    ma_uint64 playbackCursor;   // written by the audio callback
+    Lookahead* lookahead;       // file analysis ahead of playback, with --lookahead
+    double lookaheadSeconds;
+    ParameterSet parameters;
     ma_decoder_config decoderConfig;
     ma_device_config deviceConfig;
     CircularBuffer* waveform_buffer;
-    AudioQueue* btt_queue;
-    BTT* btt;
-    pthread_t btt_thread;
-    GtkWidget* tempo_label;
+    Tracker* tracker;
+    BTT* btt;   // the tracker's, for the parameter controls
+    Capture* capture;   // live input instead of a file, with --capture
+    LatencyStats beatLatency;
+    OscOutput* osc;     // with --osc host:port
+    TempoView view;
+    // The B side of the A/B view, with --vs: a follower of tracker with the second parameter
+    // set, so both analyze the same blocks
+    Tracker* compareTracker;
+    TempoView compareView;
     GtkWidget* drawing_area;
     GtkWidget *spectral_compression_gamma_label, *oss_filter_cutoff_label, *onset_threshold_label,
             *onset_threshold_min_label, *noise_cancellation_threshold_label, *autocorrelation_exponent_label,
             *min_tempo_label, *max_tempo_label, *num_tempo_candidates_label,
             *gaussian_tempo_histogram_decay_label, *gaussian_tempo_histogram_width_label,
             *log_gaussian_tempo_weight_mean_label, *log_gaussian_tempo_weight_width_label;
-    float currentTempo;
     bool isPlaying;
-    bool btt_thread_running;
     bool ui_running;
     char* audioFilePath;
 } AudioContext;
 
-Parameter params[] = {
-    // Onset detection parameters
-    {"use_amplitude_normalization", {.int_setter = btt_set_use_amplitude_normalization}, 1},
-    {"spectral_compression_gamma", {.double_setter = btt_set_spectral_compression_gamma}, 0},
-    {"oss_filter_cutoff", {.double_setter = btt_set_oss_filter_cutoff}, 0},
-    {"onset_threshold", {.double_setter = btt_set_onset_threshold}, 0},
-    {"onset_threshold_min", {.double_setter = btt_set_onset_threshold_min}, 0},
-    {"noise_cancellation_threshold", {.double_setter = btt_set_noise_cancellation_threshold}, 0},
-
-    // Tempo estimation parameters
-    {"autocorrelation_exponent", {.double_setter = btt_set_autocorrelation_exponent}, 0},
-    {"min_tempo", {.double_setter = btt_set_min_tempo}, 0},
-    {"max_tempo", {.double_setter = btt_set_max_tempo}, 0},
-    {"num_tempo_candidates", {.int_setter = btt_set_num_tempo_candidates}, 1},
-    {"gaussian_tempo_histogram_decay", {.double_setter = btt_set_gaussian_tempo_histogram_decay}, 0},
-    {"gaussian_tempo_histogram_width", {.double_setter = btt_set_gaussian_tempo_histogram_width}, 0},
-    {"log_gaussian_tempo_weight_mean", {.double_setter = btt_set_log_gaussian_tempo_weight_mean}, 0},
-    {"log_gaussian_tempo_weight_width", {.double_setter = btt_set_log_gaussian_tempo_weight_width}, 0}
-};
-
-void parse_parameters(BTT* btt, int argc, char* argv[]) {
-    for (int i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
-            char* param = argv[++i];
-            char* value_str = strchr(param, '=');
-            if (value_str) {
-                *value_str = '\0';
-                value_str++;
-                double value = atof(value_str);
-                bool invalid_parameter = TRUE;
-
-                int num_params = (int) sizeof(params) / sizeof(params[0]);
-                for (int j = 0; j < num_params; j++) {
-                    if (strcmp(param, params[j].name) == 0) {
-                        invalid_parameter = FALSE;
-                        if (params[j].is_int) {
-                            params[j].setter.int_setter(btt, (int)value);
-                        } else {
-                            params[j].setter.double_setter(btt, value);
-                        }
-                        break;
-                    }
-                }
-                if (invalid_parameter) printf("Invalid parameter: %s\n", argv[i]);
-            }
-        }
-    }
-}
-
 void data_callback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount) {
     AudioContext* context = (AudioContext*)pDevice->pUserData;
 
@@ -102,33 +81,65 @@ void data_callback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uin
         return;
     }
 
-    float* output = (float*)pOutput;
-    ma_uint64 framesRead;
-    ma_decoder_read_pcm_frames(&context->decoder, output, frameCount, &framesRead);
-
-    for (int i = 0; i < (int) framesRead; i++) {
-        writeToCircularBuffer(context->waveform_buffer, &output[i * context->decoder.outputChannels], 1);
+    ma_uint64 cursor = 0;
+    ma_decoder_get_cursor_in_pcm_frames(&context->decoder, &cursor);
+    __atomic_store_n(&context->playbackCursor, cursor, __ATOMIC_RELAXED);
+    if (context->lookahead) {
+        setLookaheadCursor(context->lookahead, (double)cursor / context->decoder.outputSampleRate);
     }
 
-    enqueueAudioFrame(context->btt_queue, output, framesRead);
+    ma_node_graph_read_pcm_frames(&context->nodeGraph, pOutput, frameCount, NULL);
 
     (void)pInput;
 }
 
-void* btt_processing_thread(void* arg) {
-    AudioContext* context = (AudioContext*)arg;
+static void on_tracker_event(const TrackerEvent* event, void* user_data) {
+    AudioContext* context = (AudioContext*)user_data;
+    if (event->type == TRACKER_EVENT_BEAT) {
+        addLatencySample(&context->beatLatency, event->latency);
+    }
+    eventStreamCallback(event, context->view.events);
+    if (context->osc) {
+        oscOutputCallback(event, context->osc);
+    }
+}
+
+static void on_compare_event(const TrackerEvent* event, void* user_data) {
+    AudioContext* context = (AudioContext*)user_data;
+    eventStreamCallback(event, context->compareView.events);
+}
 
-    while (context->btt_thread_running) {
-        AudioFrame frame = dequeueAudioFrame(context->btt_queue);
-        if (frame.data == NULL) break;  // Exit if we receive a NULL frame
-        btt_process(context->btt, frame.data, frame.frameCount);
-        double new_tempo = btt_get_tempo_bpm(context->btt);
-        if (new_tempo != context->currentTempo)
-            context->currentTempo = new_tempo;
-        // Don't free frame.data here
+static void set_event_latency(AudioContext* context, double deviceLatency) {
+    setEventStreamLatency(context->view.events, deviceLatency, EVENT_STREAM_ANALYSIS_DELAY_FRAMES);
+    if (context->compareTracker) {
+        setEventStreamLatency(context->compareView.events, deviceLatency, EVENT_STREAM_ANALYSIS_DELAY_FRAMES);
     }
+}
 
-    return NULL;
+// Applies tempo changes and queues beats to be shown at the moment they are heard
+static void drain_events(TempoView* view) {
+    StreamEvent events[32];
+    size_t count;
+    while ((count = readEventStream(view->events, events, 32)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            if (events[i].type == TRACKER_EVENT_TEMPO) {
+                view->currentTempo = events[i].tempo;
+            } else if (events[i].type == TRACKER_EVENT_BEAT && view->numPendingBeats < MAX_PENDING_BEATS) {
+                view->pendingBeats[view->numPendingBeats++] = events[i].streamTime;
+            }
+        }
+    }
+
+    double now = getMonotonicTime();
+    int kept = 0;
+    for (int i = 0; i < view->numPendingBeats; i++) {
+        if (view->pendingBeats[i] <= now) {
+            view->lastBeatTime = view->pendingBeats[i];
+        } else {
+            view->pendingBeats[kept++] = view->pendingBeats[i];
+        }
+    }
+    view->numPendingBeats = kept;
 }
 
 /**
@@ -245,6 +256,34 @@ void log_gaussian_tempo_weight_width_scale_value_changed(GtkScale *self, gpointe
  * END OF PARAMETER CALLBACKS
  **/
 
+// Marks the analyzed beats on the same time scale as the waveform, whose newest sample is the
+// playback position, including the upcoming ones to its right
+static void draw_beats(AudioContext* context, cairo_t* cr, int count, int waveformWidth, int width, int height) {
+    int samplesPerPixel = count / waveformWidth;
+    if (samplesPerPixel < 1) samplesPerPixel = 1;
+    double secondsPerPixel = samplesPerPixel / (double)context->decoder.outputSampleRate;
+    double nowX = (double)count / samplesPerPixel;
+    double cursor = getLookaheadCursor(context->lookahead);
+
+    double beats[MAX_DRAWN_BEATS];
+    size_t numBeats = getLookaheadBeats(context->lookahead, cursor - nowX * secondsPerPixel,
+                                        cursor + (width - nowX) * secondsPerPixel, beats, MAX_DRAWN_BEATS);
+
+    cairo_set_source_rgb(cr, 1.0, 0.6, 0.0);
+    cairo_new_path(cr);
+    for (size_t i = 0; i < numBeats; i++) {
+        double x = nowX + (beats[i] - cursor) / secondsPerPixel;
+        cairo_move_to(cr, x, 0);
+        cairo_line_to(cr, x, height);
+    }
+    cairo_stroke(cr);
+
+    cairo_set_source_rgba(cr, 1.0, 1.0, 1.0, 0.4);
+    cairo_move_to(cr, nowX, 0);
+    cairo_line_to(cr, nowX, height);
+    cairo_stroke(cr);
+}
+
 static void draw_waveform(GtkDrawingArea *area, cairo_t *cr, int width, int height, gpointer user_data) {
     (void) area;
     AudioContext* context = (AudioContext*)user_data;
@@ -262,37 +301,31 @@ static void draw_waveform(GtkDrawingArea *area, cairo_t *cr, int width, int heig
         return;
     }
 
+    // With lookahead the right quarter shows what is coming
+    int waveformWidth = context->lookahead ? width * 3 / 4 : width;
+    float* minValues = g_new(float, width);
+    float* maxValues = g_new(float, width);
+    int columns = reduceWaveform(data, count, waveformWidth, minValues, maxValues);
+
     cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
     cairo_set_line_width(cr, 1.0);
 
-    int samplesPerPixel = count / width;
-    if (samplesPerPixel < 1) samplesPerPixel = 1;
-
     double centerY = height / 2.0;
 
     // Draw all vertical lines in a single path
     cairo_new_path(cr);
-    for (int x = 0; x < width; x++) {
-        int startIdx = x * samplesPerPixel;
-        int endIdx = startIdx + samplesPerPixel;
-        if (endIdx > count) endIdx = count;
-        
-        if (startIdx >= count) break;
-
-        // Find min and max values for this pixel column
-        float minVal = data[startIdx];
-        float maxVal = data[startIdx];
-
-        for (int i = startIdx + 1; i < endIdx; i++) {
-            float sample = data[i];
-            if (sample < minVal) minVal = sample;
-            if (sample > maxVal) maxVal = sample;
-        }
-
-        cairo_move_to(cr, x, centerY - minVal * centerY);
-        cairo_line_to(cr, x, centerY - maxVal * centerY);
+    for (int x = 0; x < columns; x++) {
+        cairo_move_to(cr, x, centerY - minValues[x] * centerY);
+        cairo_line_to(cr, x, centerY - maxValues[x] * centerY);
     }
     cairo_stroke(cr);
+
+    if (context->lookahead) {
+        draw_beats(context, cr, count, waveformWidth, width, height);
+    }
+
+    g_free(minValues);
+    g_free(maxValues);
 }
 
 static void on_widget_destroy(gpointer data, GObject *where_the_object_was) {
@@ -301,6 +334,23 @@ static void on_widget_destroy(gpointer data, GObject *where_the_object_was) {
     *widget_pointer = NULL;
 }
 
+static void update_tempo_label(AudioContext* context, TempoView* view, const char* name) {
+    if (!view->tempo_label || !GTK_IS_LABEL(view->tempo_label)) {
+        return;
+    }
+
+    char tempo_text[112];
+    // A dot marks each beat as it is heard
+    const char* beat = getMonotonicTime() - view->lastBeatTime < BEAT_FLASH_SECONDS ? "\u25CF " : "";
+    if (context->capture) {
+        snprintf(tempo_text, sizeof(tempo_text), "%s%sTempo: %.1f BPM   Beat latency: %.1f ms (max %.1f)",
+                 beat, name, view->currentTempo, context->beatLatency.mean * 1e3, context->beatLatency.max * 1e3);
+    } else {
+        snprintf(tempo_text, sizeof(tempo_text), "%s%sTempo: %.1f BPM", beat, name, view->currentTempo);
+    }
+    gtk_label_set_text(GTK_LABEL(view->tempo_label), tempo_text);
+}
+
 static gboolean update_ui_idle(gpointer user_data) {
     AudioContext* context = (AudioContext*)user_data;
 
@@ -310,10 +360,11 @@ static gboolean update_ui_idle(gpointer user_data) {
     }
 
     // Safely update UI elements
-    if (context->tempo_label && GTK_IS_LABEL(context->tempo_label)) {
-        char tempo_text[32];
-        snprintf(tempo_text, sizeof(tempo_text), "Tempo: %.1f BPM", context->currentTempo);
-        gtk_label_set_text(GTK_LABEL(context->tempo_label), tempo_text);
+    drain_events(&context->view);
+    update_tempo_label(context, &context->view, context->compareTracker ? "A  " : "");
+    if (context->compareTracker) {
+        drain_events(&context->compareView);
+        update_tempo_label(context, &context->compareView, "B  ");
     }
 
     if (context->drawing_area && GTK_IS_WIDGET(context->drawing_area)) {
@@ -332,7 +383,7 @@ static gboolean update_ui(gpointer user_data) {
     }
 
     char tempo_text[32];
-    snprintf(tempo_text, sizeof(tempo_text), "Tempo: %.1f BPM", context->currentTempo);
+    snprintf(tempo_text, sizeof(tempo_text), "Tempo: %.1f BPM", context->view.currentTempo);
 
     // Use g_idle_add to perform UI updates
     g_idle_add(update_ui_idle, context);
@@ -340,25 +391,92 @@ static gboolean update_ui(gpointer user_data) {
     return G_SOURCE_CONTINUE;
 }
 
-static void app_shutdown(GtkApplication* app, gpointer user_data) {
-    (void) app;
-    AudioContext* context = (AudioContext*)user_data;
+// Starts analyzing the file ahead of playback and waits for the first seconds, so the tempo
+// and beats are there from the moment playback starts. Without it, playback is analyzed live.
+static void start_lookahead(AudioContext* context) {
+    context->lookahead = createLookahead(context->audioFilePath, &context->parameters, context->lookaheadSeconds);
+    if (!context->lookahead) {
+        return;
+    }
+    setLookaheadEventCallback(context->lookahead, on_tracker_event, context);
+    if (startLookahead(context->lookahead) != 0 || !waitLookahead(context->lookahead, context->lookaheadSeconds)) {
+        printf("Lookahead analysis failed, analyzing playback instead.\n");
+        destroyLookahead(context->lookahead);
+        context->lookahead = NULL;
+    }
+}
 
-    context->isPlaying = false;
-    context->btt_thread_running = false;
+static void close_lookahead(AudioContext* context) {
+    if (context->lookahead) {
+        destroyLookahead(context->lookahead);
+        context->lookahead = NULL;
+    }
+}
+
+static bool init_playback_graph(AudioContext* context) {
+    ma_uint32 channels = context->decoder.outputChannels;
+    ma_node_graph_config graphConfig = ma_node_graph_config_init(channels);
+    if (ma_node_graph_init(&graphConfig, NULL, &context->nodeGraph) != MA_SUCCESS) {
+        return false;
+    }
+
+    ma_data_source_node_config sourceConfig = ma_data_source_node_config_init(&context->decoder);
+    if (ma_data_source_node_init(&context->nodeGraph, &sourceConfig, NULL, &context->sourceNode) != MA_SUCCESS) {
+        ma_node_graph_uninit(&context->nodeGraph, NULL);
+        return false;
+    }
+
+    // With lookahead the node only feeds the waveform; the analysis is already done
+    Tracker* tracker = context->lookahead ? NULL : context->tracker;
+    if (initAnalysisNode(&context->nodeGraph, channels, tracker, context->waveform_buffer,
+                         &context->analysisNode) != MA_SUCCESS) {
+        ma_data_source_node_uninit(&context->sourceNode, NULL);
+        ma_node_graph_uninit(&context->nodeGraph, NULL);
+        return false;
+    }
 
-    enqueueAudioFrame(context->btt_queue, NULL, 0);
-    pthread_join(context->btt_thread, NULL);
+    ma_node_attach_output_bus(&context->sourceNode, 0, &context->analysisNode, 0);
+    ma_node_attach_output_bus(&context->analysisNode, 0, ma_node_graph_get_endpoint(&context->nodeGraph), 0);
+    return true;
+}
+
+static void uninit_playback_graph(AudioContext* context) {
+    uninitAnalysisNode(&context->analysisNode);
+    ma_data_source_node_uninit(&context->sourceNode, NULL);
+    ma_node_graph_uninit(&context->nodeGraph, NULL);
+}
 
+static void close_playback(AudioContext* context) {
     if (ma_device_is_started(&context->device)) {
         ma_device_stop(&context->device);
     }
     ma_device_uninit(&context->device);
+    uninit_playback_graph(context);
     ma_decoder_uninit(&context->decoder);
+    close_lookahead(context);
+}
+
+static void app_shutdown(GtkApplication* app, gpointer user_data) {
+    (void) app;
+    AudioContext* context = (AudioContext*)user_data;
+
+    context->isPlaying = false;
+
+    if (context->capture) {
+        stopCapture(context->capture);
+        destroyCapture(context->capture);
+    } else {
+        close_playback(context);
+    }
 
     destroyCircularBuffer(context->waveform_buffer);
-    destroyAudioQueue(context->btt_queue);
-    btt_destroy(context->btt);
+    destroyTracker(context->tracker);
+    destroyEventStream(context->view.events);
+    if (context->compareTracker) {
+        destroyTracker(context->compareTracker);
+        destroyEventStream(context->compareView.events);
+    }
+    if (context->osc) destroyOscOutput(context->osc);
     free(context->audioFilePath);
 }
 
@@ -374,6 +492,20 @@ static bool init_miniaudio(AudioContext* context) {
         return false;
     }
 
+    ma_decoder_get_length_in_pcm_frames(&context->decoder, &context->playbackLength);
+    context->playbackCursor = 0;
+
+    if (context->lookaheadSeconds > 0) {
+        start_lookahead(context);
+    }
+
+    if (!init_playback_graph(context)) {
+        printf("Failed to build the playback graph.\n");
+        close_lookahead(context);
+        ma_decoder_uninit(&context->decoder);
+        return false;
+    }
+
     ma_device_config deviceConfig = ma_device_config_init(ma_device_type_playback);
     deviceConfig.playback.format = context->decoder.outputFormat;
     deviceConfig.playback.channels = context->decoder.outputChannels;
@@ -383,14 +515,19 @@ static bool init_miniaudio(AudioContext* context) {
 
     if (ma_device_init(NULL, &deviceConfig, &context->device) != MA_SUCCESS) {
         printf("Failed to open playback device.\n");
+        uninit_playback_graph(context);
+        close_lookahead(context);
         ma_decoder_uninit(&context->decoder);
         return false;
     }
+    set_event_latency(context, getDeviceLatency(&context->device));
+    if (context->osc) {
+        setOscOutputLatency(context->osc, getDeviceLatency(&context->device));
+    }
 
     if (ma_device_start(&context->device) != MA_SUCCESS) {
         printf("Failed to start playback device.\n");
-        ma_device_uninit(&context->device);
-        ma_decoder_uninit(&context->decoder);
+        close_playback(context);
         return false;
     }
 
@@ -398,16 +535,17 @@ static bool init_miniaudio(AudioContext* context) {
 }
 
 static void reinitialize_audio(AudioContext* context, const char* new_file_path) {
-    // Stop current playback and processing
+    // Stop current playback
     context->isPlaying = false;
-    context->btt_thread_running = false;
     
-    // Stop and clean up current audio
-    if (ma_device_is_started(&context->device)) {
-        ma_device_stop(&context->device);
+    // Stop and clean up current audio; opening a file ends live capture
+    if (context->capture) {
+        stopCapture(context->capture);
+        destroyCapture(context->capture);
+        context->capture = NULL;
+    } else {
+        close_playback(context);
     }
-    ma_device_uninit(&context->device);
-    ma_decoder_uninit(&context->decoder);
 
     // Update file path
     free(context->audioFilePath);
@@ -415,14 +553,12 @@ static void reinitialize_audio(AudioContext* context, const char* new_file_path)
 
     // Reset buffers
     clearCircularBuffer(context->waveform_buffer);
-    clearAudioQueue(context->btt_queue);
+    clearTracker(context->tracker);
 
     if (!init_miniaudio(context)) {
         return;
     }
 
-    // Restart processing
-    context->btt_thread_running = true;
     context->isPlaying = true;
 }
 
@@ -581,6 +717,38 @@ static gboolean on_key_press(GtkEventController *controller, guint keyval, guint
     return FALSE; // Let other handlers process the event
 }
 
+// Ctrl+Left and Ctrl+Right seek the file being played. Seeking an MP3 or FLAC decoder can take
+// a while, so the device is stopped around it rather than the audio thread doing it.
+static gboolean on_seek_key_press(GtkEventController *controller, guint keyval, guint keycode,
+                                  GdkModifierType state, gpointer user_data) {
+    (void)controller;
+    (void)keycode;
+    AudioContext* context = (AudioContext*)user_data;
+    if (!(state & GDK_CONTROL_MASK) || (keyval != GDK_KEY_Left && keyval != GDK_KEY_Right) ||
+        context->capture || !context->audioFilePath || !context->isPlaying) {
+        return FALSE;
+    }
+
+    double step = (keyval == GDK_KEY_Right ? SEEK_STEP_SECONDS : -SEEK_STEP_SECONDS) * context->decoder.outputSampleRate;
+    double target = (double)__atomic_load_n(&context->playbackCursor, __ATOMIC_RELAXED) + step;
+    if (target < 0) target = 0;
+    if (context->playbackLength > 0 && target > (double)context->playbackLength) target = (double)context->playbackLength;
+
+    ma_device_stop(&context->device);
+    ma_decoder_seek_to_pcm_frame(&context->decoder, (ma_uint64)target);
+    ma_uint64 cursor = 0;
+    ma_decoder_get_cursor_in_pcm_frames(&context->decoder, &cursor);
+    __atomic_store_n(&context->playbackCursor, cursor, __ATOMIC_RELAXED);
+    if (ma_device_start(&context->device) != MA_SUCCESS) {
+        printf("Failed to restart playback after seeking.\n");
+    }
+
+    // Beats queued for the old position will not be heard
+    context->view.numPendingBeats = 0;
+    context->compareView.numPendingBeats = 0;
+    return TRUE;
+}
+
 static void activate(GtkApplication* app, gpointer user_data) {
     AudioContext* context = (AudioContext*)user_data;
     GtkWidget *window, *grid, *tempo_label, *drawing_area, *header_bar, *scrolled_window;
@@ -610,6 +778,9 @@ static void activate(GtkApplication* app, gpointer user_data) {
     if (context->audioFilePath && !init_miniaudio(context)) {
         return;
     }
+    if (context->capture && startCapture(context->capture) != 0) {
+        return;
+    }
 
     context->ui_running = TRUE;
 
@@ -660,7 +831,16 @@ static void activate(GtkApplication* app, gpointer user_data) {
 
     tempo_label = gtk_label_new("Tempo: 0 BPM");
     gtk_widget_add_css_class(tempo_label, "tempo-display");
-    gtk_grid_attach(GTK_GRID(grid), tempo_label, 0, 0, 10, 1);
+    if (context->compareTracker) {
+        // A and B side by side; the parameter controls below change A
+        gtk_grid_attach(GTK_GRID(grid), tempo_label, 0, 0, 5, 1);
+        context->compareView.tempo_label = gtk_label_new("Tempo: 0 BPM");
+        gtk_widget_add_css_class(context->compareView.tempo_label, "tempo-display");
+        gtk_grid_attach(GTK_GRID(grid), context->compareView.tempo_label, 5, 0, 5, 1);
+        g_object_weak_ref(G_OBJECT(context->compareView.tempo_label), on_widget_destroy, &context->compareView.tempo_label);
+    } else {
+        gtk_grid_attach(GTK_GRID(grid), tempo_label, 0, 0, 10, 1);
+    }
 
     drawing_area = gtk_drawing_area_new();
     gtk_widget_set_hexpand(drawing_area, TRUE);
@@ -854,10 +1034,10 @@ static void activate(GtkApplication* app, gpointer user_data) {
     gtk_box_append(GTK_BOX(log_gaussian_tempo_weight_width_box), log_gaussian_tempo_weight_width_scale);
     gtk_grid_attach(GTK_GRID(grid), log_gaussian_tempo_weight_width_box, 7, 7, 2, 2);
 
-    context->tempo_label = tempo_label;
+    context->view.tempo_label = tempo_label;
     context->drawing_area = drawing_area;
 
-    g_object_weak_ref(G_OBJECT(context->tempo_label), on_widget_destroy, &context->tempo_label);
+    g_object_weak_ref(G_OBJECT(context->view.tempo_label), on_widget_destroy, &context->view.tempo_label);
     g_object_weak_ref(G_OBJECT(context->drawing_area), on_widget_destroy, &context->drawing_area);
     g_timeout_add(25, update_ui, context);
     
@@ -865,36 +1045,109 @@ static void activate(GtkApplication* app, gpointer user_data) {
     g_signal_connect(key_controller, "key-pressed", G_CALLBACK(on_key_press), grid);
     gtk_widget_add_controller(window, key_controller);
 
+    // Seen before the focused widget, so the sliders do not take the arrow keys
+    GtkEventController *seek_controller = gtk_event_controller_key_new();
+    gtk_event_controller_set_propagation_phase(seek_controller, GTK_PHASE_CAPTURE);
+    g_signal_connect(seek_controller, "key-pressed", G_CALLBACK(on_seek_key_press), context);
+    gtk_widget_add_controller(window, seek_controller);
+
     gtk_window_present(GTK_WINDOW(window));
 }
 
 int main(int argc, char** argv) {
     AudioContext context = {0};
-    
-    if (argc >= 2) {
-        context.audioFilePath = strdup(argv[1]);
-    } else {
-        context.audioFilePath = NULL;
-    }
-    context.waveform_buffer = createCircularBuffer(CIRCULAR_BUFFER_SIZE);
-    context.isPlaying = context.audioFilePath != NULL;
-    context.currentTempo = 0;
 
-    context.btt = btt_new_default();
-    btt_set_tracking_mode(context.btt, BTT_ONSET_AND_TEMPO_TRACKING);
-    parse_parameters(context.btt, argc, argv);
+    if (wants_headless(argc, argv)) {
+        return run_headless(argc, argv);
+    }
 
-    context.btt_queue = createAudioQueue(1024);  // Adjust capacity as needed
-    context.btt_thread_running = true;
+    bool live = false;
+    const char* oscAddress = NULL;
+    context.audioFilePath = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            i++;  // handled by collect_parameter_sets
+        } else if (strcmp(argv[i], PARAMETER_SET_SEPARATOR) == 0) {
+            continue;
+        } else if (strcmp(argv[i], "--capture") == 0) {
+            live = true;
+        } else if (strcmp(argv[i], "--osc") == 0 && i + 1 < argc) {
+            oscAddress = argv[++i];
+        } else if (strcmp(argv[i], "--lookahead") == 0) {
+            context.lookaheadSeconds = LOOKAHEAD_DEFAULT_SECONDS;
+            // The number of seconds is optional
+            char* end;
+            double seconds = i + 1 < argc ? strtod(argv[i + 1], &end) : 0;
+            if (seconds > 0 && *end == '\0') {
+                context.lookaheadSeconds = seconds;
+                i++;
+            }
+        } else if (!context.audioFilePath && !live) {
+            context.audioFilePath = strdup(argv[i]);
+        }
+    }
+    context.waveform_buffer = createCircularBuffer(CIRCULAR_BUFFER_SIZE);
+    context.isPlaying = context.audioFilePath != NULL || live;
+    context.view.currentTempo = 0;
+
+    ParameterSet parameterSets[2];
+    int numSets = collect_parameter_sets(parameterSets, 2, argc, argv);
+    context.parameters = parameterSets[0];
+    context.tracker = createTracker(BTT_ONSET_AND_TEMPO_AND_BEAT_TRACKING, &context.parameters);
+    context.view.events = createEventStream(EVENT_STREAM_CAPACITY, context.tracker->sampleRate);
+    context.btt = context.tracker->btt;
+    setTrackerEventCallback(context.tracker, on_tracker_event, &context);
+
+    if (numSets == 2 && context.lookaheadSeconds > 0) {
+        printf("--vs is not available with --lookahead; showing the first parameter set.\n");
+    } else if (numSets == 2) {
+        context.compareTracker = createTracker(BTT_ONSET_AND_TEMPO_AND_BEAT_TRACKING, &parameterSets[1]);
+        context.compareView.events = createEventStream(EVENT_STREAM_CAPACITY, context.tracker->sampleRate);
+        setTrackerEventCallback(context.compareTracker, on_compare_event, &context);
+        addTrackerFollower(context.tracker, context.compareTracker);
+    }
 
-    if (pthread_create(&context.btt_thread, NULL, btt_processing_thread, &context) != 0) {
+    if (startTracker(context.tracker) != 0) {
         printf("Failed to create BTT processing thread.\n");
         destroyCircularBuffer(context.waveform_buffer);
-        destroyAudioQueue(context.btt_queue);
+        destroyTracker(context.tracker);
+        destroyEventStream(context.view.events);
+        if (context.compareTracker) {
+            destroyTracker(context.compareTracker);
+            destroyEventStream(context.compareView.events);
+        }
         free(context.audioFilePath);
         return -3;
     }
 
+    if (live) {
+        context.capture = createCapture(context.tracker, context.waveform_buffer, 0);
+        if (!context.capture) {
+            destroyCircularBuffer(context.waveform_buffer);
+            destroyTracker(context.tracker);
+            destroyEventStream(context.view.events);
+            if (context.compareTracker) {
+                destroyTracker(context.compareTracker);
+                destroyEventStream(context.compareView.events);
+            }
+            free(context.audioFilePath);
+            return -4;
+        }
+        set_event_latency(&context, getDeviceLatency(&context.capture->device));
+    }
+
+    if (oscAddress) {
+        context.osc = createOscOutput(oscAddress, context.tracker->sampleRate);
+        if (context.osc && context.capture) {
+            setOscOutputLatency(context.osc, getDeviceLatency(&context.capture->device));
+        }
+        if (context.osc && startOscOutput(context.osc) != 0) {
+            printf("Failed to start the OSC sender thread.\n");
+            destroyOscOutput(context.osc);
+            context.osc = NULL;
+        }
+    }
+
     GtkApplication *app;
     int status;
 
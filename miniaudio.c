@@ -0,0 +1,2 @@
+#define MINIAUDIO_IMPLEMENTATION
+#include "lib/miniaudio.h"
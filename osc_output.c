@@ -0,0 +1,229 @@
+#include "osc_output.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define INVALID_SOCKET_HANDLE INVALID_SOCKET
+#define close_socket closesocket
+#else
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET_HANDLE (-1)
+#define close_socket close
+#endif
+
+#include "event_stream.h"
+#include "timing.h"
+
+#define OSC_EVENT_CAPACITY 1024
+#define OSC_MAX_PACKET 32
+#define OSC_POLL_SECONDS 0.001
+// Seconds from the NTP epoch (1900) to the Unix epoch
+#define NTP_UNIX_OFFSET 2208988800.0
+
+// A preformatted message; only the arguments after argsOffset change between sends
+typedef struct {
+    unsigned char data[OSC_MAX_PACKET];
+    int size;
+    int argsOffset;
+} OscPacket;
+
+struct OscOutput {
+    EventStream* events;
+    socket_t socket;
+    struct sockaddr_storage address;
+    socklen_t addressLength;
+    OscPacket tempoPacket;
+    OscPacket beatPacket;
+    OscPacket onsetPacket;
+    int beatCount;
+    pthread_t thread;
+    bool threadRunning;
+    int stopRequested;
+};
+
+/**
+ * OSC encoding: strings are NUL terminated and padded to 4 bytes, numbers are big endian
+ */
+static int pad_string(unsigned char* out, const char* text) {
+    int length = (int)strlen(text) + 1;
+    int padded = (length + 3) & ~3;
+    memset(out, 0, padded);
+    memcpy(out, text, length);
+    return padded;
+}
+
+static void init_packet(OscPacket* packet, const char* address, const char* typeTags, int argsSize) {
+    int offset = pad_string(packet->data, address);
+    offset += pad_string(packet->data + offset, typeTags);
+    packet->argsOffset = offset;
+    packet->size = offset + argsSize;
+}
+
+static void write_uint32(unsigned char* out, unsigned int value) {
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)value;
+}
+
+static void write_float(unsigned char* out, float value) {
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    write_uint32(out, bits);
+}
+
+// Converts a getMonotonicTime() value to an NTP time tag on the wall clock
+static void write_time_tag(unsigned char* out, double monotonicTime) {
+    double ntp = getWallClockTime() + (monotonicTime - getMonotonicTime()) + NTP_UNIX_OFFSET;
+    double seconds = (double)(unsigned long long)ntp;
+    write_uint32(out, (unsigned int)(unsigned long long)seconds);
+    write_uint32(out + 4, (unsigned int)((ntp - seconds) * 4294967296.0));
+}
+
+static void send_packet(OscOutput* output, const OscPacket* packet) {
+    sendto(output->socket, (const char*)packet->data, packet->size, 0,
+           (const struct sockaddr*)&output->address, output->addressLength);
+}
+
+static void send_event(OscOutput* output, const StreamEvent* event) {
+    OscPacket* packet;
+    switch (event->type) {
+        case TRACKER_EVENT_TEMPO:
+            packet = &output->tempoPacket;
+            write_float(packet->data + packet->argsOffset, (float)event->tempo);
+            break;
+        case TRACKER_EVENT_BEAT:
+            packet = &output->beatPacket;
+            write_uint32(packet->data + packet->argsOffset, (unsigned int)output->beatCount++);
+            write_time_tag(packet->data + packet->argsOffset + 4, event->streamTime);
+            break;
+        case TRACKER_EVENT_ONSET:
+        default:
+            packet = &output->onsetPacket;
+            write_float(packet->data + packet->argsOffset, event->strength);
+            break;
+    }
+    send_packet(output, packet);
+}
+
+static void* osc_thread(void* arg) {
+    OscOutput* output = (OscOutput*)arg;
+    StreamEvent events[64];
+
+    // The event stream is lock free, so the analysis thread cannot wake us; a 1 ms poll keeps
+    // the added latency well under an audio period
+    while (!__atomic_load_n(&output->stopRequested, __ATOMIC_ACQUIRE)) {
+        size_t count = readEventStream(output->events, events, 64);
+        if (count == 0) {
+            sleepSeconds(OSC_POLL_SECONDS);
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            send_event(output, &events[i]);
+        }
+    }
+
+    return NULL;
+}
+
+static bool resolve_address(OscOutput* output, const char* address) {
+    char host[256];
+    const char* colon = strrchr(address, ':');
+    if (!colon || colon == address || (size_t)(colon - address) >= sizeof(host)) {
+        printf("OSC address must be host:port: %s\n", address);
+        return false;
+    }
+    memcpy(host, address, colon - address);
+    host[colon - address] = '\0';
+
+    struct addrinfo hints;
+    struct addrinfo* result;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, colon + 1, &hints, &result) != 0) {
+        printf("Could not resolve OSC address: %s\n", address);
+        return false;
+    }
+
+    output->socket = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    memcpy(&output->address, result->ai_addr, result->ai_addrlen);
+    output->addressLength = (socklen_t)result->ai_addrlen;
+    freeaddrinfo(result);
+
+    if (output->socket == INVALID_SOCKET_HANDLE) {
+        printf("Could not open OSC socket\n");
+        return false;
+    }
+    return true;
+}
+
+OscOutput* createOscOutput(const char* address, double sampleRate) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        return NULL;
+    }
+#endif
+
+    OscOutput* output = (OscOutput*)calloc(1, sizeof(OscOutput));
+    output->socket = INVALID_SOCKET_HANDLE;
+    if (!resolve_address(output, address)) {
+        destroyOscOutput(output);
+        return NULL;
+    }
+
+    output->events = createEventStream(OSC_EVENT_CAPACITY, sampleRate);
+    init_packet(&output->tempoPacket, "/tempo", ",f", 4);
+    init_packet(&output->beatPacket, "/beat", ",it", 4 + 8);
+    init_packet(&output->onsetPacket, "/onset", ",f", 4);
+    return output;
+}
+
+void destroyOscOutput(OscOutput* output) {
+    stopOscOutput(output);
+    if (output->socket != INVALID_SOCKET_HANDLE) close_socket(output->socket);
+    if (output->events) destroyEventStream(output->events);
+    free(output);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+int startOscOutput(OscOutput* output) {
+    if (output->threadRunning) {
+        return 0;
+    }
+    output->stopRequested = 0;
+    if (pthread_create(&output->thread, NULL, osc_thread, output) != 0) {
+        return -1;
+    }
+    output->threadRunning = true;
+    return 0;
+}
+
+void stopOscOutput(OscOutput* output) {
+    if (!output->threadRunning) {
+        return;
+    }
+    __atomic_store_n(&output->stopRequested, 1, __ATOMIC_RELEASE);
+    pthread_join(output->thread, NULL);
+    output->threadRunning = false;
+}
+
+void setOscOutputLatency(OscOutput* output, double deviceLatency) {
+    setEventStreamLatency(output->events, deviceLatency, EVENT_STREAM_ANALYSIS_DELAY_FRAMES);
+}
+
+void oscOutputCallback(const TrackerEvent* event, void* userData) {
+    eventStreamCallback(event, ((OscOutput*)userData)->events);
+}
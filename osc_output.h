@@ -0,0 +1,30 @@
+#ifndef OSC_OUTPUT_H
+#define OSC_OUTPUT_H
+
+#include "tracker.h"
+
+#define OSC_DEFAULT_ADDRESS "127.0.0.1:9000"
+
+// Sends tempo, beats and onsets as OSC over UDP:
+//   /tempo f    tempo in BPM, on every change
+//   /beat i t   running beat count, and the time the beat is heard as an OSC time tag
+//   /onset f    onset strength
+// The analysis thread only writes into the output's event stream; a sender thread formats
+// the messages into buffers prepared up front and sends them, so nothing is allocated and
+// nothing blocks per event.
+typedef struct OscOutput OscOutput;
+
+// address is "host:port"; sampleRate is the tracker's. Returns NULL if the address does not
+// resolve or the socket cannot be opened.
+OscOutput* createOscOutput(const char* address, double sampleRate);
+void destroyOscOutput(OscOutput* output);
+int startOscOutput(OscOutput* output);
+void stopOscOutput(OscOutput* output);
+
+// Device latency as for setEventStreamLatency(); can be changed while audio runs
+void setOscOutputLatency(OscOutput* output, double deviceLatency);
+
+// A TrackerEventCallback; userData is the OscOutput
+void oscOutputCallback(const TrackerEvent* event, void* userData);
+
+#endif // OSC_OUTPUT_H
@@ -0,0 +1,95 @@
+#include "parameters.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const Parameter params[] = {
+    // Onset detection parameters
+    {"use_amplitude_normalization", {.int_setter = btt_set_use_amplitude_normalization}, 1},
+    {"spectral_compression_gamma", {.double_setter = btt_set_spectral_compression_gamma}, 0},
+    {"oss_filter_cutoff", {.double_setter = btt_set_oss_filter_cutoff}, 0},
+    {"onset_threshold", {.double_setter = btt_set_onset_threshold}, 0},
+    {"onset_threshold_min", {.double_setter = btt_set_onset_threshold_min}, 0},
+    {"noise_cancellation_threshold", {.double_setter = btt_set_noise_cancellation_threshold}, 0},
+
+    // Tempo estimation parameters
+    {"autocorrelation_exponent", {.double_setter = btt_set_autocorrelation_exponent}, 0},
+    {"min_tempo", {.double_setter = btt_set_min_tempo}, 0},
+    {"max_tempo", {.double_setter = btt_set_max_tempo}, 0},
+    {"num_tempo_candidates", {.int_setter = btt_set_num_tempo_candidates}, 1},
+    {"gaussian_tempo_histogram_decay", {.double_setter = btt_set_gaussian_tempo_histogram_decay}, 0},
+    {"gaussian_tempo_histogram_width", {.double_setter = btt_set_gaussian_tempo_histogram_width}, 0},
+    {"log_gaussian_tempo_weight_mean", {.double_setter = btt_set_log_gaussian_tempo_weight_mean}, 0},
+    {"log_gaussian_tempo_weight_width", {.double_setter = btt_set_log_gaussian_tempo_weight_width}, 0}
+};
+
+const int num_params = (int) sizeof(params) / sizeof(params[0]);
+
+const Parameter* find_parameter(const char* name) {
+    for (int j = 0; j < num_params; j++) {
+        if (strcmp(name, params[j].name) == 0) {
+            return &params[j];
+        }
+    }
+    return NULL;
+}
+
+static void add_override(ParameterSet* set, const char* param) {
+    const char* value_str = strchr(param, '=');
+    if (!value_str) return;
+
+    // Copy the name so argv stays untouched and can be parsed again
+    char name[64];
+    size_t name_length = (size_t)(value_str - param);
+    if (name_length >= sizeof(name)) name_length = sizeof(name) - 1;
+    memcpy(name, param, name_length);
+    name[name_length] = '\0';
+
+    const Parameter* parameter = find_parameter(name);
+    if (!parameter) {
+        printf("Invalid parameter: %s\n", param);
+        return;
+    }
+    if (set->count == MAX_PARAMETER_OVERRIDES) {
+        printf("Too many parameters, ignoring: %s\n", param);
+        return;
+    }
+    set->overrides[set->count].parameter = parameter;
+    set->overrides[set->count].value = atof(value_str + 1);
+    set->count++;
+}
+
+int collect_parameter_sets(ParameterSet* sets, int max_sets, int argc, char* argv[]) {
+    int current = 0;
+    sets[0].count = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], PARAMETER_SET_SEPARATOR) == 0) {
+            if (current + 1 == max_sets) break;
+            sets[++current].count = 0;
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            add_override(&sets[current], argv[++i]);
+        }
+    }
+    return current + 1;
+}
+
+void collect_parameters(ParameterSet* set, int argc, char* argv[]) {
+    collect_parameter_sets(set, 1, argc, argv);
+}
+
+void apply_parameters(BTT* btt, const ParameterSet* set) {
+    for (int i = 0; i < set->count; i++) {
+        const ParameterOverride* override = &set->overrides[i];
+        if (override->parameter->is_int) {
+            override->parameter->setter.int_setter(btt, (int)override->value);
+        } else {
+            override->parameter->setter.double_setter(btt, override->value);
+        }
+    }
+}
+
+void parse_parameters(BTT* btt, int argc, char* argv[]) {
+    ParameterSet set;
+    collect_parameters(&set, argc, argv);
+    apply_parameters(btt, &set);
+}
@@ -0,0 +1,41 @@
+#ifndef PARAMETERS_H
+#define PARAMETERS_H
+
+#include "lib/Beat-and-Tempo-Tracking/BTT.h"
+
+#define MAX_PARAMETER_OVERRIDES 32
+// Separates the "-i" arguments of parameter sets to compare, as in "-i a=1 --vs -i a=2"
+#define PARAMETER_SET_SEPARATOR "--vs"
+
+typedef struct _Parameter{
+    const char* name;
+    union _setter{
+        void (*double_setter)(BTT*, double);
+        void (*int_setter)(BTT*, int);
+    } setter;
+    int is_int;
+} Parameter;
+
+typedef struct {
+    const Parameter* parameter;
+    double value;
+} ParameterOverride;
+
+// A parsed list of "-i name=value" arguments that can be applied to any number of BTT objects
+typedef struct {
+    ParameterOverride overrides[MAX_PARAMETER_OVERRIDES];
+    int count;
+} ParameterSet;
+
+extern const Parameter params[];
+extern const int num_params;
+
+const Parameter* find_parameter(const char* name);
+// Collects the "-i" arguments before the first --vs
+void collect_parameters(ParameterSet* set, int argc, char* argv[]);
+// Collects one set per --vs separated group, up to max_sets; returns the number of sets
+int collect_parameter_sets(ParameterSet* sets, int max_sets, int argc, char* argv[]);
+void apply_parameters(BTT* btt, const ParameterSet* set);
+void parse_parameters(BTT* btt, int argc, char* argv[]);
+
+#endif // PARAMETERS_H
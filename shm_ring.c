@@ -0,0 +1,262 @@
+// memfd_create
+#define _GNU_SOURCE
+
+#include "shm_ring.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+// The waiting flags and sequences need a full barrier between a store and the following load
+#define LOAD_SEQ(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define STORE_SEQ(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+
+static size_t frame_size(uint32_t format) {
+    return format == SHM_FORMAT_S16 ? sizeof(int16_t) : sizeof(float);
+}
+
+// The ring is shared between processes, so these are not FUTEX_PRIVATE_FLAG
+static void futex_wait(uint32_t* address, uint32_t expected, int timeoutMs) {
+    struct timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (long)(timeoutMs % 1000) * 1000000L;
+    syscall(SYS_futex, address, FUTEX_WAIT, expected, timeoutMs < 0 ? NULL : &timeout, NULL, 0);
+}
+
+static void futex_wake(uint32_t* address) {
+    syscall(SYS_futex, address, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static ShmRing* map_ring(int fd, size_t size) {
+    void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+
+    ShmRing* ring = (ShmRing*)calloc(1, sizeof(ShmRing));
+    ring->header = (ShmRingHeader*)mapping;
+    ring->mappedSize = size;
+    ring->fd = fd;
+    return ring;
+}
+
+ShmRing* createShmRing(const char* name, size_t capacity, unsigned sampleRate, ShmSampleFormat format) {
+    size_t rounded = 1;
+    while (rounded < capacity) rounded <<= 1;
+
+    int fd;
+    if (name) {
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    } else {
+        fd = memfd_create("tempotest-ring", MFD_CLOEXEC);
+    }
+    if (fd < 0) {
+        printf("Could not create shared memory ring %s\n", name ? name : "(memfd)");
+        return NULL;
+    }
+
+    size_t dataOffset = (sizeof(ShmRingHeader) + 63) & ~(size_t)63;
+    size_t size = dataOffset + rounded * frame_size(format);
+    ShmRing* ring = ftruncate(fd, (off_t)size) == 0 ? map_ring(fd, size) : NULL;
+    if (!ring) {
+        close(fd);
+        if (name) shm_unlink(name);
+        return NULL;
+    }
+
+    // ftruncate zero fills, so the indices and flags start at 0
+    ShmRingHeader* header = ring->header;
+    header->version = SHM_RING_VERSION;
+    header->dataOffset = (uint32_t)dataOffset;
+    header->sampleRate = sampleRate;
+    header->format = (uint32_t)format;
+    header->capacity = rounded;
+    STORE_RELEASE(&header->magic, SHM_RING_MAGIC);
+
+    ring->data = (unsigned char*)header + dataOffset;
+    ring->capacity = rounded;
+    ring->format = format;
+    ring->frameSize = frame_size(format);
+    ring->owner = true;
+    if (name) {
+        snprintf(ring->name, sizeof(ring->name), "%s", name);
+    }
+    return ring;
+}
+
+ShmRing* openShmRingFd(int fd) {
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(ShmRingHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    ShmRing* ring = map_ring(fd, (size_t)info.st_size);
+    if (!ring) {
+        close(fd);
+        return NULL;
+    }
+
+    // Each field is read once; the checks are written so that none of them can overflow
+    ShmRingHeader* header = ring->header;
+    bool valid = LOAD_ACQUIRE(&header->magic) == SHM_RING_MAGIC;
+    uint32_t version = header->version;
+    size_t dataOffset = header->dataOffset;
+    uint32_t format = header->format;
+    uint64_t capacity = header->capacity;
+    valid = valid && version == SHM_RING_VERSION;
+    valid = valid && (format == SHM_FORMAT_F32 || format == SHM_FORMAT_S16);
+    valid = valid && capacity != 0 && (capacity & (capacity - 1)) == 0;
+    valid = valid && dataOffset >= sizeof(ShmRingHeader) && dataOffset <= ring->mappedSize;
+    valid = valid && capacity <= (ring->mappedSize - dataOffset) / frame_size(format);
+    if (!valid) {
+        printf("Not a compatible shared memory ring\n");
+        closeShmRing(ring);
+        return NULL;
+    }
+
+    ring->data = (unsigned char*)header + dataOffset;
+    ring->capacity = (size_t)capacity;
+    ring->format = (ShmSampleFormat)format;
+    ring->frameSize = frame_size(format);
+    return ring;
+}
+
+ShmRing* openShmRing(const char* name) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        printf("Could not open shared memory ring %s\n", name);
+        return NULL;
+    }
+    return openShmRingFd(fd);
+}
+
+void closeShmRing(ShmRing* ring) {
+    munmap(ring->header, ring->mappedSize);
+    close(ring->fd);
+    if (ring->owner && ring->name[0]) {
+        shm_unlink(ring->name);
+    }
+    free(ring);
+}
+
+/**
+ * Producer
+ */
+size_t getShmRingWritable(ShmRing* ring) {
+    ShmRingHeader* header = ring->header;
+    uint64_t used = header->writeIndex - LOAD_ACQUIRE(&header->readIndex);
+    return used < ring->capacity ? ring->capacity - (size_t)used : 0;
+}
+
+size_t writeShmRing(ShmRing* ring, const void* frames, size_t count) {
+    ShmRingHeader* header = ring->header;
+    size_t writable = getShmRingWritable(ring);
+    if (count > writable) count = writable;
+    if (count == 0) return 0;
+
+    uint64_t writeIndex = header->writeIndex;
+    size_t start = (size_t)(writeIndex & (ring->capacity - 1));
+    size_t firstRun = ring->capacity - start;
+    if (firstRun > count) firstRun = count;
+    memcpy(ring->data + start * ring->frameSize, frames, firstRun * ring->frameSize);
+    memcpy(ring->data, (const unsigned char*)frames + firstRun * ring->frameSize, (count - firstRun) * ring->frameSize);
+
+    STORE_RELEASE(&header->writeIndex, writeIndex + count);
+    __atomic_add_fetch(&header->dataSequence, 1, __ATOMIC_SEQ_CST);
+    if (LOAD_SEQ(&header->consumerWaiting)) {
+        futex_wake(&header->dataSequence);
+    }
+    return count;
+}
+
+bool waitShmRingWritable(ShmRing* ring, size_t count, int timeoutMs) {
+    ShmRingHeader* header = ring->header;
+    if (count > ring->capacity) count = ring->capacity;
+
+    while (getShmRingWritable(ring) < count) {
+        uint32_t sequence = LOAD_SEQ(&header->spaceSequence);
+        STORE_SEQ(&header->producerWaiting, 1);
+        // The consumer may have made room between the check above and announcing ourselves
+        if (getShmRingWritable(ring) >= count) {
+            STORE_SEQ(&header->producerWaiting, 0);
+            break;
+        }
+        futex_wait(&header->spaceSequence, sequence, timeoutMs);
+        STORE_SEQ(&header->producerWaiting, 0);
+        if (timeoutMs >= 0) {
+            return getShmRingWritable(ring) >= count;
+        }
+    }
+    return true;
+}
+
+void finishShmRing(ShmRing* ring) {
+    ShmRingHeader* header = ring->header;
+    STORE_SEQ(&header->closed, 1);
+    __atomic_add_fetch(&header->dataSequence, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&header->dataSequence);
+}
+
+/**
+ * Consumer
+ */
+const void* peekShmRing(ShmRing* ring, size_t* count) {
+    ShmRingHeader* header = ring->header;
+    uint64_t readIndex = header->readIndex;
+    uint64_t readable = LOAD_ACQUIRE(&header->writeIndex) - readIndex;
+    if (readable > ring->capacity) {
+        // More than the ring holds: the producer is broken, and the run would leave the mapping
+        ring->broken = true;
+        *count = 0;
+        return ring->data;
+    }
+    size_t start = (size_t)(readIndex & (ring->capacity - 1));
+    size_t run = ring->capacity - start;
+    *count = (size_t)readable < run ? (size_t)readable : run;
+    return ring->data + start * ring->frameSize;
+}
+
+void consumeShmRing(ShmRing* ring, size_t count) {
+    ShmRingHeader* header = ring->header;
+    STORE_RELEASE(&header->readIndex, header->readIndex + count);
+    __atomic_add_fetch(&header->spaceSequence, 1, __ATOMIC_SEQ_CST);
+    if (LOAD_SEQ(&header->producerWaiting)) {
+        futex_wake(&header->spaceSequence);
+    }
+}
+
+bool isShmRingFinished(ShmRing* ring) {
+    ShmRingHeader* header = ring->header;
+    return ring->broken || (LOAD_ACQUIRE(&header->closed) && LOAD_ACQUIRE(&header->writeIndex) == header->readIndex);
+}
+
+bool waitShmRingReadable(ShmRing* ring, int timeoutMs) {
+    ShmRingHeader* header = ring->header;
+    for (;;) {
+        if (LOAD_ACQUIRE(&header->writeIndex) != header->readIndex || LOAD_ACQUIRE(&header->closed)) {
+            return true;
+        }
+
+        uint32_t sequence = LOAD_SEQ(&header->dataSequence);
+        STORE_SEQ(&header->consumerWaiting, 1);
+        if (LOAD_SEQ(&header->writeIndex) != header->readIndex || LOAD_SEQ(&header->closed)) {
+            STORE_SEQ(&header->consumerWaiting, 0);
+            return true;
+        }
+        futex_wait(&header->dataSequence, sequence, timeoutMs);
+        STORE_SEQ(&header->consumerWaiting, 0);
+        if (timeoutMs >= 0) {
+            return LOAD_ACQUIRE(&header->writeIndex) != header->readIndex || LOAD_ACQUIRE(&header->closed);
+        }
+    }
+}
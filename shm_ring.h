@@ -0,0 +1,86 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Single producer / single consumer ring of mono audio in shared memory, so that another
+// process can hand PCM to the tracker without sockets. The reader takes the samples straight
+// from the mapping; the tracker makes the one copy, converting to BTT's sample type on the way.
+//
+// The mapping starts with a ShmRingHeader and the samples follow at dataOffset. Indices are
+// free running frame counts; the producer owns writeIndex, the consumer owns readIndex, and
+// writable space is capacity - (writeIndex - readIndex), which is how the producer sees
+// backpressure. Both sides sleep on futexes in the header when there is nothing to do: the
+// producer bumps dataSequence after publishing and the consumer bumps spaceSequence after
+// consuming, each waking the other only if it announced that it is waiting. Linux only.
+
+#define SHM_RING_MAGIC 0x314d485354545454ull    // "TTTTSHM1"
+#define SHM_RING_VERSION 1
+
+typedef enum {
+    SHM_FORMAT_F32 = 0,     // copied into the tracker's block
+    SHM_FORMAT_S16 = 1      // converted to float, then copied into the tracker's block
+} ShmSampleFormat;
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t dataOffset;
+    uint32_t sampleRate;
+    uint32_t format;                // ShmSampleFormat
+    uint64_t capacity;              // frames, power of two
+
+    // Written by the producer
+    uint64_t writeIndex __attribute__((aligned(64)));
+    uint32_t dataSequence;
+    uint32_t producerWaiting;
+    uint32_t closed;                // no more data will be written
+
+    // Written by the consumer
+    uint64_t readIndex __attribute__((aligned(64)));
+    uint32_t spaceSequence;
+    uint32_t consumerWaiting;
+} ShmRingHeader;
+
+// The other process can write the whole header, so the layout is checked once when the ring is
+// opened and only these copies are used afterwards
+typedef struct {
+    ShmRingHeader* header;
+    unsigned char* data;
+    size_t capacity;
+    ShmSampleFormat format;
+    size_t frameSize;
+    size_t mappedSize;
+    bool broken;        // the other side published an impossible index
+    int fd;
+    char name[64];      // empty for memfd rings
+    bool owner;         // unlinks the name when closed
+} ShmRing;
+
+// Creates a ring under name with shm_open, or an anonymous memfd when name is NULL; the
+// memfd can be passed to the producer over a Unix socket. capacity is rounded up to a power
+// of two.
+ShmRing* createShmRing(const char* name, size_t capacity, unsigned sampleRate, ShmSampleFormat format);
+ShmRing* openShmRing(const char* name);
+ShmRing* openShmRingFd(int fd);
+void closeShmRing(ShmRing* ring);
+
+// Producer
+size_t getShmRingWritable(ShmRing* ring);
+size_t writeShmRing(ShmRing* ring, const void* frames, size_t count);
+// Waits until count frames are writable; returns false on timeout (timeoutMs < 0 waits forever)
+bool waitShmRingWritable(ShmRing* ring, size_t count, int timeoutMs);
+void finishShmRing(ShmRing* ring);
+
+// Consumer. peekShmRing() returns the longest contiguous readable run, in place in the
+// mapping; consumeShmRing() hands it back to the producer once it has been processed.
+const void* peekShmRing(ShmRing* ring, size_t* count);
+void consumeShmRing(ShmRing* ring, size_t count);
+// Waits until data is readable or the producer finished; returns false on timeout
+bool waitShmRingReadable(ShmRing* ring, int timeoutMs);
+// Also true once the ring is broken, which peekShmRing() detects
+bool isShmRingFinished(ShmRing* ring);
+
+#endif // SHM_RING_H
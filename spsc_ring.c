@@ -0,0 +1,71 @@
+#include "spsc_ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The indices are free running; acquire/release ordering makes the element copies visible
+// before the index that publishes them
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+SpscRing* createSpscRing(size_t capacity, size_t elementSize) {
+    size_t rounded = 1;
+    while (rounded < capacity) rounded <<= 1;
+
+    SpscRing* ring = (SpscRing*)calloc(1, sizeof(SpscRing));
+    ring->data = (unsigned char*)malloc(rounded * elementSize);
+    ring->elementSize = elementSize;
+    ring->capacity = rounded;
+    ring->mask = rounded - 1;
+    return ring;
+}
+
+void destroySpscRing(SpscRing* ring) {
+    free(ring->data);
+    free(ring);
+}
+
+static void copy_in(SpscRing* ring, size_t index, const unsigned char* src, size_t count) {
+    size_t start = index & ring->mask;
+    size_t firstRun = ring->capacity - start;
+    if (firstRun > count) firstRun = count;
+    memcpy(ring->data + start * ring->elementSize, src, firstRun * ring->elementSize);
+    memcpy(ring->data, src + firstRun * ring->elementSize, (count - firstRun) * ring->elementSize);
+}
+
+static void copy_out(SpscRing* ring, size_t index, unsigned char* dst, size_t count) {
+    size_t start = index & ring->mask;
+    size_t firstRun = ring->capacity - start;
+    if (firstRun > count) firstRun = count;
+    memcpy(dst, ring->data + start * ring->elementSize, firstRun * ring->elementSize);
+    memcpy(dst + firstRun * ring->elementSize, ring->data, (count - firstRun) * ring->elementSize);
+}
+
+size_t writeSpscRing(SpscRing* ring, const void* elements, size_t count) {
+    size_t writeIndex = ring->writeIndex;
+    size_t readIndex = LOAD_ACQUIRE(&ring->readIndex);
+    size_t writable = ring->capacity - (writeIndex - readIndex);
+    if (count > writable) count = writable;
+
+    copy_in(ring, writeIndex, (const unsigned char*)elements, count);
+    STORE_RELEASE(&ring->writeIndex, writeIndex + count);
+    return count;
+}
+
+size_t readSpscRing(SpscRing* ring, void* elements, size_t count) {
+    size_t readIndex = ring->readIndex;
+    size_t writeIndex = LOAD_ACQUIRE(&ring->writeIndex);
+    size_t readable = writeIndex - readIndex;
+    if (count > readable) count = readable;
+
+    copy_out(ring, readIndex, (unsigned char*)elements, count);
+    STORE_RELEASE(&ring->readIndex, readIndex + count);
+    return count;
+}
+
+size_t getSpscRingReadable(SpscRing* ring) {
+    return LOAD_ACQUIRE(&ring->writeIndex) - LOAD_ACQUIRE(&ring->readIndex);
+}
+
+size_t getSpscRingWritable(SpscRing* ring) {
+    return ring->capacity - getSpscRingReadable(ring);
+}
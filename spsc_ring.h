@@ -0,0 +1,28 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+
+// Lock-free single producer / single consumer ring of fixed size elements. One thread may
+// write and one other thread may read at the same time without locking.
+typedef struct {
+    unsigned char* data;
+    size_t elementSize;
+    size_t capacity;    // power of two, in elements
+    size_t mask;
+    size_t writeIndex;  // only advanced by the producer
+    size_t readIndex;   // only advanced by the consumer
+} SpscRing;
+
+// capacity is rounded up to a power of two
+SpscRing* createSpscRing(size_t capacity, size_t elementSize);
+void destroySpscRing(SpscRing* ring);
+
+// Both return the number of elements actually copied, which may be less than count
+size_t writeSpscRing(SpscRing* ring, const void* elements, size_t count);
+size_t readSpscRing(SpscRing* ring, void* elements, size_t count);
+
+size_t getSpscRingReadable(SpscRing* ring);
+size_t getSpscRingWritable(SpscRing* ring);
+
+#endif // SPSC_RING_H
@@ -0,0 +1,189 @@
+#include "test_signal.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib/miniaudio.h"
+
+#define CLICK_SECONDS 0.03
+#define KICK_SECONDS 0.25
+#define SNARE_SECONDS 0.15
+#define HIHAT_SECONDS 0.05
+
+TestSignalConfig testSignalConfigInit(TestSignalPattern pattern, double bpm, double seconds) {
+    TestSignalConfig config;
+    config.pattern = pattern;
+    config.sampleRate = 44100;
+    config.seconds = seconds;
+    config.startBpm = bpm;
+    config.endBpm = bpm;
+    config.swing = 0;
+    config.snrDb = TEST_SIGNAL_NO_NOISE;
+    config.seed = 4321;
+    return config;
+}
+
+/* Adds an exponentially decaying sine burst starting at frame start */
+static void add_tone(float* out, size_t frameCount, size_t start, unsigned int sampleRate,
+                     double frequency, double amplitude, double seconds, double decay) {
+    if (start >= frameCount) return;
+
+    size_t length = (size_t)(seconds * sampleRate);
+    if (start + length > frameCount) length = frameCount - start;
+
+    float* tone = (float*)malloc(length * sizeof(float));
+    ma_waveform_config config = ma_waveform_config_init(ma_format_f32, 1, sampleRate, ma_waveform_type_sine, amplitude, frequency);
+    ma_waveform waveform;
+    ma_waveform_init(&config, &waveform);
+    ma_waveform_read_pcm_frames(&waveform, tone, length, NULL);
+    ma_waveform_uninit(&waveform);
+
+    for (size_t i = 0; i < length; i++) {
+        out[start + i] += tone[i] * (float)exp(-decay * (double)i / sampleRate);
+    }
+    free(tone);
+}
+
+/* Same for white noise; the seed makes every burst reproducible */
+static void add_noise_burst(float* out, size_t frameCount, size_t start, unsigned int sampleRate,
+                            int seed, double amplitude, double seconds, double decay) {
+    if (start >= frameCount) return;
+
+    size_t length = (size_t)(seconds * sampleRate);
+    if (start + length > frameCount) length = frameCount - start;
+
+    float* burst = (float*)malloc(length * sizeof(float));
+    ma_noise_config config = ma_noise_config_init(ma_format_f32, 1, ma_noise_type_white, seed, amplitude);
+    ma_noise noise;
+    ma_noise_init(&config, NULL, &noise);
+    ma_noise_read_pcm_frames(&noise, burst, length, NULL);
+    ma_noise_uninit(&noise, NULL);
+
+    for (size_t i = 0; i < length; i++) {
+        out[start + i] += burst[i] * (float)exp(-decay * (double)i / sampleRate);
+    }
+    free(burst);
+}
+
+static double tempo_at(const TestSignalConfig* config, double time) {
+    return config->startBpm + (config->endBpm - config->startBpm) * time / config->seconds;
+}
+
+static void add_noise(const TestSignalConfig* config, float* samples, size_t frameCount) {
+    double signalPower = 0;
+    for (size_t i = 0; i < frameCount; i++) signalPower += (double)samples[i] * samples[i];
+    signalPower /= (double)frameCount;
+
+    float* noise = (float*)malloc(frameCount * sizeof(float));
+    ma_noise_config noiseConfig = ma_noise_config_init(ma_format_f32, 1, ma_noise_type_white, config->seed + 1, 1.0);
+    ma_noise generator;
+    ma_noise_init(&noiseConfig, NULL, &generator);
+    ma_noise_read_pcm_frames(&generator, noise, frameCount, NULL);
+    ma_noise_uninit(&generator, NULL);
+
+    // Scale by the measured noise power rather than assuming the generator's distribution
+    double noisePower = 0;
+    for (size_t i = 0; i < frameCount; i++) noisePower += (double)noise[i] * noise[i];
+    noisePower /= (double)frameCount;
+
+    double targetPower = signalPower / pow(10.0, config->snrDb / 10.0);
+    float gain = (noisePower > 0) ? (float)sqrt(targetPower / noisePower) : 0.0f;
+    for (size_t i = 0; i < frameCount; i++) {
+        samples[i] += gain * noise[i];
+    }
+    free(noise);
+}
+
+int generateTestSignal(const TestSignalConfig* config, TestSignal* signal) {
+    memset(signal, 0, sizeof(*signal));
+    if (config->startBpm <= 0 || config->endBpm <= 0 || config->seconds <= 0) {
+        return -1;
+    }
+
+    unsigned int rate = config->sampleRate;
+    size_t frameCount = (size_t)(config->seconds * rate);
+    float* samples = (float*)calloc(frameCount, sizeof(float));
+    int capacity = (int)(config->seconds * fmax(config->startBpm, config->endBpm) / 60.0) + 2;
+    double* beats = (double*)malloc(capacity * sizeof(double));
+    int numBeats = 0;
+
+    double time = 0;
+    int beatIndex = 0;
+    while (time < config->seconds && numBeats < capacity) {
+        double period = 60.0 / tempo_at(config, time);
+        size_t frame = (size_t)(time * rate);
+        int beatInBar = beatIndex % 4;
+
+        beats[numBeats++] = time;
+
+        if (config->pattern == TEST_SIGNAL_CLICK_TRACK) {
+            double frequency = (beatInBar == 0) ? 1500.0 : 1000.0;
+            add_tone(samples, frameCount, frame, rate, frequency, 0.8, CLICK_SECONDS, 150.0);
+        } else {
+            if (beatInBar == 0 || beatInBar == 2) {
+                add_tone(samples, frameCount, frame, rate, 55.0, 0.9, KICK_SECONDS, 20.0);
+            } else {
+                add_noise_burst(samples, frameCount, frame, rate, config->seed + beatIndex, 0.5, SNARE_SECONDS, 30.0);
+                add_tone(samples, frameCount, frame, rate, 180.0, 0.3, SNARE_SECONDS, 30.0);
+            }
+
+            // Hi-hat on both eighths; swing pushes the off-beat one later
+            size_t offBeat = (size_t)((time + period * (0.5 + 0.5 * config->swing)) * rate);
+            add_noise_burst(samples, frameCount, frame, rate, config->seed + 7919 * beatIndex, 0.15, HIHAT_SECONDS, 120.0);
+            add_noise_burst(samples, frameCount, offBeat, rate, config->seed + 7919 * beatIndex + 1, 0.1, HIHAT_SECONDS, 120.0);
+        }
+
+        time += period;
+        beatIndex++;
+    }
+
+    if (config->snrDb < TEST_SIGNAL_NO_NOISE) {
+        add_noise(config, samples, frameCount);
+    }
+
+    signal->samples = samples;
+    signal->frameCount = frameCount;
+    signal->sampleRate = rate;
+    signal->beats = beats;
+    signal->numBeats = numBeats;
+    signal->bpm = config->endBpm;
+    return 0;
+}
+
+void freeTestSignal(TestSignal* signal) {
+    free(signal->samples);
+    free(signal->beats);
+    memset(signal, 0, sizeof(*signal));
+}
+
+int writeTestSignal(const TestSignal* signal, const char* basePath) {
+    char path[4096];
+
+    snprintf(path, sizeof(path), "%s.wav", basePath);
+    ma_encoder_config config = ma_encoder_config_init(ma_encoding_format_wav, ma_format_f32, 1, signal->sampleRate);
+    ma_encoder encoder;
+    if (ma_encoder_init_file(path, &config, &encoder) != MA_SUCCESS) {
+        return -1;
+    }
+    ma_result result = ma_encoder_write_pcm_frames(&encoder, signal->samples, signal->frameCount, NULL);
+    ma_encoder_uninit(&encoder);
+    if (result != MA_SUCCESS) {
+        return -1;
+    }
+
+    snprintf(path, sizeof(path), "%s.beats", basePath);
+    FILE* file = fopen(path, "w");
+    if (!file) return -1;
+    for (int i = 0; i < signal->numBeats; i++) {
+        fprintf(file, "%.6f\n", signal->beats[i]);
+    }
+    fclose(file);
+
+    snprintf(path, sizeof(path), "%s.bpm", basePath);
+    file = fopen(path, "w");
+    if (!file) return -1;
+    fprintf(file, "%.3f\n", signal->bpm);
+    fclose(file);
+    return 0;
+}
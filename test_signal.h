@@ -0,0 +1,41 @@
+#ifndef TEST_SIGNAL_H
+#define TEST_SIGNAL_H
+
+#include <stddef.h>
+
+typedef enum {
+    TEST_SIGNAL_CLICK_TRACK,    // metronome clicks, accented downbeat
+    TEST_SIGNAL_DRUM_PATTERN    // kick on 1 and 3, snare on 2 and 4, hi-hat eighths
+} TestSignalPattern;
+
+#define TEST_SIGNAL_NO_NOISE 1000.0
+
+typedef struct {
+    TestSignalPattern pattern;
+    unsigned int sampleRate;
+    double seconds;
+    double startBpm;
+    double endBpm;      // tempo changes linearly from startBpm to endBpm
+    double swing;       // 0 = straight, 1 = off-beat eighths fall on the next beat
+    double snrDb;       // white noise relative to the signal RMS, TEST_SIGNAL_NO_NOISE for none
+    int seed;
+} TestSignalConfig;
+
+typedef struct {
+    float* samples;     // mono
+    size_t frameCount;
+    unsigned int sampleRate;
+    double* beats;      // seconds
+    int numBeats;
+    double bpm;         // tempo at the end, which the final estimate is scored against
+} TestSignal;
+
+TestSignalConfig testSignalConfigInit(TestSignalPattern pattern, double bpm, double seconds);
+// The output only depends on the config, so the same config always renders the same samples
+int generateTestSignal(const TestSignalConfig* config, TestSignal* signal);
+void freeTestSignal(TestSignal* signal);
+
+// Writes <basePath>.wav plus <basePath>.beats and <basePath>.bpm in the format tempotest_eval reads
+int writeTestSignal(const TestSignal* signal, const char* basePath);
+
+#endif // TEST_SIGNAL_H
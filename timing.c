@@ -0,0 +1,27 @@
+#include "timing.h"
+#include <time.h>
+
+double getMonotonicTime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+double getWallClockTime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void sleepSeconds(double seconds) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+void addLatencySample(LatencyStats* stats, double latency) {
+    stats->count++;
+    stats->mean += (latency - stats->mean) / (double)stats->count;
+    if (latency > stats->max) stats->max = latency;
+}
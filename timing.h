@@ -0,0 +1,19 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+// Seconds on a monotonic clock, for measuring intervals
+double getMonotonicTime(void);
+// Seconds since the Unix epoch
+double getWallClockTime(void);
+void sleepSeconds(double seconds);
+
+// Running mean and maximum of latency samples, in seconds
+typedef struct {
+    unsigned long long count;
+    double mean;
+    double max;
+} LatencyStats;
+
+void addLatencySample(LatencyStats* stats, double latency);
+
+#endif // TIMING_H
@@ -0,0 +1,215 @@
+#include "tracker.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "downmix.h"
+#include "timing.h"
+
+#define TRACKER_CHUNK_FRAMES 1024
+// How long the tracker thread sleeps when there is no audio; the audio callback cannot wake
+// it without a lock
+#define TRACKER_POLL_SECONDS 0.001
+
+typedef struct {
+    float samples[TRACKER_BLOCK_FRAMES];
+    int frameCount;
+    double arrivalTime;     // getMonotonicTime() when the block was pushed
+} TrackerBlock;
+
+static void emit_event(Tracker* tracker, TrackerEventType type, unsigned long long sampleIndex) {
+    if (!tracker->callback) return;
+
+    TrackerEvent event;
+    event.type = type;
+    event.sampleIndex = sampleIndex;
+    event.time = (double)sampleIndex / tracker->sampleRate;
+    event.tempo = tracker->tempo;
+    event.latency = 0;
+    event.arrivalTime = 0;
+    if (tracker->blockArrival > 0) {
+        // blockArrival is when the last sample of the block came in
+        event.latency = getMonotonicTime() - tracker->blockArrival;
+        event.arrivalTime = tracker->blockArrival - ((double)tracker->blockEnd - (double)sampleIndex) / tracker->sampleRate;
+    }
+    event.level = tracker->blockPeak;
+    tracker->callback(&event, tracker->userData);
+}
+
+static void onset_callback(void* self, unsigned long long sample_time) {
+    emit_event((Tracker*)self, TRACKER_EVENT_ONSET, sample_time);
+}
+
+static void beat_callback(void* self, unsigned long long sample_time) {
+    emit_event((Tracker*)self, TRACKER_EVENT_BEAT, sample_time);
+}
+
+Tracker* createTracker(btt_tracking_mode_t mode, const ParameterSet* parameters) {
+    Tracker* tracker = (Tracker*)calloc(1, sizeof(Tracker));
+    tracker->btt = btt_new_default();
+    if (!tracker->btt) {
+        free(tracker);
+        return NULL;
+    }
+
+    tracker->sampleRate = btt_get_sample_rate(tracker->btt);
+    btt_set_tracking_mode(tracker->btt, mode);
+    btt_set_onset_tracking_callback(tracker->btt, onset_callback, tracker);
+    btt_set_beat_tracking_callback(tracker->btt, beat_callback, tracker);
+    if (parameters) {
+        apply_parameters(tracker->btt, parameters);
+    }
+
+    return tracker;
+}
+
+void destroyTracker(Tracker* tracker) {
+    stopTracker(tracker);
+    if (tracker->input) destroySpscRing(tracker->input);
+    btt_destroy(tracker->btt);
+    free(tracker);
+}
+
+void setTrackerEventCallback(Tracker* tracker, TrackerEventCallback callback, void* userData) {
+    tracker->callback = callback;
+    tracker->userData = userData;
+}
+
+static void process_block(Tracker* tracker, dft_sample_t* samples, int count) {
+    // btt_process may use its input as scratch, so each follower gets its own copy
+    for (int i = 0; i < tracker->numFollowers; i++) {
+        Tracker* follower = tracker->followers[i];
+        dft_sample_t copy[TRACKER_CHUNK_FRAMES];
+        memcpy(copy, samples, (size_t)count * sizeof(dft_sample_t));
+        follower->blockArrival = tracker->blockArrival;
+        process_block(follower, copy, count);
+    }
+
+    float peak = 0;
+    for (int i = 0; i < count; i++) {
+        float magnitude = samples[i] < 0 ? -(float)samples[i] : (float)samples[i];
+        if (magnitude > peak) peak = magnitude;
+    }
+    tracker->blockPeak = peak;
+    tracker->blockEnd = tracker->samplesProcessed + (unsigned long long)count;
+
+    btt_process(tracker->btt, samples, count);
+    tracker->samplesProcessed += (unsigned long long)count;
+
+    double tempo = btt_get_tempo_bpm(tracker->btt);
+    if (tempo != tracker->tempo) {
+        tracker->tempo = tempo;
+        emit_event(tracker, TRACKER_EVENT_TEMPO, tracker->samplesProcessed);
+    }
+}
+
+void processTrackerAudio(Tracker* tracker, const float* samples, size_t frameCount) {
+    // btt_process takes a non-const pointer, so feed it through a scratch block
+    dft_sample_t block[TRACKER_CHUNK_FRAMES];
+    for (size_t pos = 0; pos < frameCount; pos += TRACKER_CHUNK_FRAMES) {
+        int count = (frameCount - pos < TRACKER_CHUNK_FRAMES) ? (int)(frameCount - pos) : TRACKER_CHUNK_FRAMES;
+        for (int i = 0; i < count; i++) {
+            block[i] = samples[pos + i];
+        }
+        process_block(tracker, block, count);
+    }
+}
+
+void processTrackerSamples(Tracker* tracker, dft_sample_t* samples, size_t frameCount) {
+    for (size_t pos = 0; pos < frameCount; pos += TRACKER_CHUNK_FRAMES) {
+        int count = (frameCount - pos < TRACKER_CHUNK_FRAMES) ? (int)(frameCount - pos) : TRACKER_CHUNK_FRAMES;
+        process_block(tracker, samples + pos, count);
+    }
+}
+
+static void* tracker_thread(void* arg) {
+    Tracker* tracker = (Tracker*)arg;
+
+    TrackerBlock block;
+
+    for (;;) {
+        if (readSpscRing(tracker->input, &block, 1) == 0) {
+            if (__atomic_load_n(&tracker->stopRequested, __ATOMIC_ACQUIRE)) break;
+            sleepSeconds(TRACKER_POLL_SECONDS);
+            continue;
+        }
+        tracker->blocksRead++;
+        if (tracker->blocksRead <= __atomic_load_n(&tracker->discardBlocks, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+
+        tracker->blockArrival = block.arrivalTime;
+        // The ring carries float; only convert if BTT was built with another sample type
+        if (sizeof(dft_sample_t) == sizeof(float)) {
+            process_block(tracker, (dft_sample_t*)block.samples, block.frameCount);
+        } else {
+            processTrackerAudio(tracker, block.samples, (size_t)block.frameCount);
+        }
+    }
+
+    return NULL;
+}
+
+int startTracker(Tracker* tracker) {
+    if (tracker->threadRunning) {
+        return 0;
+    }
+    // Only threaded trackers need a ring; batch jobs create many synchronous ones
+    if (!tracker->input) {
+        tracker->input = createSpscRing(TRACKER_QUEUE_CAPACITY, sizeof(TrackerBlock));
+    }
+    tracker->stopRequested = 0;
+    if (pthread_create(&tracker->thread, NULL, tracker_thread, tracker) != 0) {
+        return -1;
+    }
+    tracker->threadRunning = true;
+    return 0;
+}
+
+void stopTracker(Tracker* tracker) {
+    if (!tracker->threadRunning) {
+        return;
+    }
+    __atomic_store_n(&tracker->stopRequested, 1, __ATOMIC_RELEASE);
+    pthread_join(tracker->thread, NULL);
+    tracker->threadRunning = false;
+}
+
+void pushTrackerAudio(Tracker* tracker, const float* frames, size_t frameCount, int channels) {
+    TrackerBlock block;
+    double callbackTime = getMonotonicTime();
+    for (size_t pos = 0; pos < frameCount; pos += TRACKER_BLOCK_FRAMES) {
+        size_t count = (frameCount - pos < TRACKER_BLOCK_FRAMES) ? frameCount - pos : TRACKER_BLOCK_FRAMES;
+        // Only the callback's last frame arrived at callbackTime; each block ends the remaining frames earlier
+        block.arrivalTime = callbackTime - (double)(frameCount - (pos + count)) / tracker->sampleRate;
+        downmixToMono(frames + pos * channels, block.samples, count, channels);
+        block.frameCount = (int)count;
+        if (writeSpscRing(tracker->input, &block, 1) == 0) {
+            __atomic_add_fetch(&tracker->droppedFrames, (unsigned long long)count, __ATOMIC_RELAXED);
+            continue;
+        }
+        __atomic_store_n(&tracker->blocksPushed, tracker->blocksPushed + 1, __ATOMIC_RELEASE);
+    }
+}
+
+// The ring can only be emptied by its reader, so the tracker thread skips the blocks instead
+void clearTracker(Tracker* tracker) {
+    __atomic_store_n(&tracker->discardBlocks, __atomic_load_n(&tracker->blocksPushed, __ATOMIC_ACQUIRE),
+                     __ATOMIC_RELEASE);
+}
+
+int addTrackerFollower(Tracker* tracker, Tracker* follower) {
+    if (tracker->numFollowers == MAX_TRACKER_FOLLOWERS) {
+        return -1;
+    }
+    tracker->followers[tracker->numFollowers++] = follower;
+    return 0;
+}
+
+void removeTrackerFollower(Tracker* tracker, Tracker* follower) {
+    for (int i = 0; i < tracker->numFollowers; i++) {
+        if (tracker->followers[i] == follower) {
+            tracker->followers[i] = tracker->followers[--tracker->numFollowers];
+            return;
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef TRACKER_H
+#define TRACKER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "lib/Beat-and-Tempo-Tracking/BTT.h"
+#include "parameters.h"
+#include "spsc_ring.h"
+
+// Blocks of up to TRACKER_BLOCK_FRAMES between pushTrackerAudio() and the tracker thread
+#define TRACKER_QUEUE_CAPACITY 1024
+#define TRACKER_BLOCK_FRAMES 256
+#define MAX_TRACKER_FOLLOWERS 7
+
+typedef enum {
+    TRACKER_EVENT_ONSET,
+    TRACKER_EVENT_BEAT,
+    TRACKER_EVENT_TEMPO
+} TrackerEventType;
+
+typedef struct {
+    TrackerEventType type;
+    unsigned long long sampleIndex;     // position in the analyzed stream
+    double time;                        // sampleIndex in seconds
+    double tempo;                       // current estimate in BPM
+    double latency;                     // seconds from the block arriving in pushTrackerAudio()
+                                        // to the event, 0 for processTrackerAudio()
+    double arrivalTime;                 // getMonotonicTime() at which sampleIndex arrived,
+                                        // 0 for processTrackerAudio()
+    float level;                        // peak level of the block being analyzed
+} TrackerEvent;
+
+// Called on the thread that runs btt_process
+typedef void (*TrackerEventCallback)(const TrackerEvent* event, void* userData);
+
+// Drives one BTT. Audio is either processed synchronously with processTrackerAudio(), or
+// pushed from an audio callback with pushTrackerAudio() and analyzed on the tracker's thread.
+// Followers are trackers, usually with other parameters, that are run over the same blocks.
+typedef struct Tracker Tracker;
+struct Tracker {
+    BTT* btt;
+    SpscRing* input;        // TrackerBlock, created by startTracker()
+    pthread_t thread;
+    bool threadRunning;
+    int stopRequested;
+    unsigned long long blocksPushed;    // written by the producer, atomic
+    unsigned long long blocksRead;      // tracker thread only
+    unsigned long long discardBlocks;   // clearTracker() drops blocks up to this count, atomic
+    unsigned long long droppedFrames;   // pushed while the queue was full, atomic
+    double sampleRate;
+    unsigned long long samplesProcessed;
+    double blockArrival;    // arrival time of the block being processed, 0 if synchronous
+    unsigned long long blockEnd;
+    float blockPeak;
+    double tempo;
+    TrackerEventCallback callback;
+    void* userData;
+    Tracker* followers[MAX_TRACKER_FOLLOWERS];
+    int numFollowers;
+};
+
+Tracker* createTracker(btt_tracking_mode_t mode, const ParameterSet* parameters);
+void destroyTracker(Tracker* tracker);
+void setTrackerEventCallback(Tracker* tracker, TrackerEventCallback callback, void* userData);
+
+void processTrackerAudio(Tracker* tracker, const float* samples, size_t frameCount);
+// Same without the conversion copy, for callers that already hold BTT's sample type. BTT may
+// use its input as scratch, so samples can be overwritten.
+void processTrackerSamples(Tracker* tracker, dft_sample_t* samples, size_t frameCount);
+
+int startTracker(Tracker* tracker);
+// Analyzes what was already pushed, then stops the thread
+void stopTracker(Tracker* tracker);
+// Downmixes interleaved audio and hands it to the tracker thread through a lock-free ring, so
+// it neither allocates nor blocks and is safe in an audio callback; audio that does not fit
+// is dropped and counted in droppedFrames. One producer at a time, and only valid after
+// startTracker().
+void pushTrackerAudio(Tracker* tracker, const float* frames, size_t frameCount, int channels);
+// Drops audio that was pushed but not analyzed yet
+void clearTracker(Tracker* tracker);
+
+// Runs follower, a tracker that is not started, on every block tracker analyzes and on the
+// same thread, so the downmix, queue and conversion are done once for both and their events
+// share a sample clock. The follower is not owned. Add and remove followers while no audio is
+// being analyzed. Returns -1 if there are too many followers.
+int addTrackerFollower(Tracker* tracker, Tracker* follower);
+void removeTrackerFollower(Tracker* tracker, Tracker* follower);
+
+#endif // TRACKER_H
@@ -0,0 +1,30 @@
+#include "waveform.h"
+
+int reduceWaveform(const float* data, int count, int width, float* minValues, float* maxValues) {
+    int samplesPerPixel = count / width;
+    if (samplesPerPixel < 1) samplesPerPixel = 1;
+
+    int x;
+    for (x = 0; x < width; x++) {
+        int startIdx = x * samplesPerPixel;
+        int endIdx = startIdx + samplesPerPixel;
+        if (endIdx > count) endIdx = count;
+
+        if (startIdx >= count) break;
+
+        // Find min and max values for this pixel column
+        float minVal = data[startIdx];
+        float maxVal = data[startIdx];
+
+        for (int i = startIdx + 1; i < endIdx; i++) {
+            float sample = data[i];
+            if (sample < minVal) minVal = sample;
+            if (sample > maxVal) maxVal = sample;
+        }
+
+        minValues[x] = minVal;
+        maxValues[x] = maxVal;
+    }
+
+    return x;
+}
@@ -0,0 +1,8 @@
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+// Reduces count samples to one min/max pair per pixel column. Returns the number of
+// columns filled, which is less than width when there are fewer samples than pixels.
+int reduceWaveform(const float* data, int count, int width, float* minValues, float* maxValues);
+
+#endif // WAVEFORM_H